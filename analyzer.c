@@ -0,0 +1,722 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "gc.h"
+#include "symbols.h"
+#include "interpreter.h"
+
+// The variables of one scope, in slot order. A scope exists only while the form
+// that creates it is being analyzed; its arrays are malloc'ed, and freed after.
+//
+// Every lambda gets two scopes: one for its frame (its parameters and internal
+// defines), and outside that a closure scope for the variables it captures from
+// the scopes around it. A closure scope starts out empty and grows as references
+// to those variables turn up (see capture).
+typedef struct Scope {
+    SchemeItem **names;
+    bool *boxed; // which variables' slots hold a box instead of their value
+    char *uses;  // how each variable is used (see findBoxes), or NULL
+    SchemeItem **constants; // for a let, the constant each variable stands for, if any
+    bool *guarded;          // whether that constant came from a folded call
+    int count;
+    int capacity;
+    bool closure;
+    SchemeItem *captures; // for a closure scope, where each variable is captured from, last first
+    struct Scope *parent;
+} Scope;
+
+// How a variable is used in a scope, for findBoxes
+#define USED_IN_LAMBDA 1
+#define ASSIGNED 2
+
+SchemeItem *analyzeExpr(SchemeItem *expr, Scope *scope);
+SchemeItem *resolve(SchemeItem *symbol, Scope *scope);
+
+// Allocates memory for a scope's arrays, which only last until it is freed
+void *scopeAlloc(size_t size) {
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == NULL) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    return memory;
+}
+
+// Creates a scope with room for capacity names. Every scope is freed with
+// freeScope once its form has been analyzed, so analyzing a long program one
+// form at a time doesn't use up more and more memory.
+Scope makeScope(Scope *parent, int capacity) {
+    Scope scope;
+    scope.capacity = capacity > 0 ? capacity : 1;
+    scope.names = scopeAlloc(scope.capacity * sizeof(SchemeItem *));
+    scope.boxed = scopeAlloc(scope.capacity * sizeof(bool));
+    scope.uses = NULL;
+    scope.constants = NULL;
+    scope.guarded = NULL;
+    scope.count = 0;
+    scope.closure = false;
+    scope.captures = makeEmpty();
+    scope.parent = parent;
+    return scope;
+}
+
+// Frees a scope's arrays
+void freeScope(Scope *scope) {
+    free(scope->names);
+    free(scope->boxed);
+    free(scope->uses);
+    free(scope->constants);
+    free(scope->guarded);
+}
+
+// Returns the slot index of name in the scope, or -1 if it isn't there
+int findName(Scope *scope, SchemeItem *name) {
+    for (int i = 0; i < scope->count; i++) {
+        if (scope->names[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Gives name the next slot in the scope, rejecting duplicates
+void addName(Scope *scope, SchemeItem *name) {
+    if (findName(scope, name) != -1) {
+        printf("Evaluation error: duplicate binding for '%s'\n", name->s);
+        texit(1);
+    }
+    scope->names[scope->count] = name;
+    scope->boxed[scope->count] = false;
+    scope->count++;
+}
+
+// Returns whether expr is a list headed by the keyword for the given special form
+bool isForm(SchemeItem *expr, specialForm form) {
+    return typeOf(expr) == CONS_TYPE && typeOf(expr->car) == SYMBOL_TYPE && expr->car->form == form;
+}
+
+// Counts the internal defines at the start of a body (including ones inside begin)
+int countDefines(SchemeItem *body) {
+    int count = 0;
+    while (typeOf(body) == CONS_TYPE) {
+        SchemeItem *form = body->car;
+        if (isForm(form, DEFINE_FORM) && typeOf(form->cdr) == CONS_TYPE && typeOf(form->cdr->car) == SYMBOL_TYPE) {
+            count++;
+        } else if (isForm(form, BEGIN_FORM)) {
+            count = count + countDefines(form->cdr);
+        }
+        body = body->cdr;
+    }
+    return count;
+}
+
+// Gives every internal define in a body a slot in the body's scope
+void addDefines(Scope *scope, SchemeItem *body) {
+    while (typeOf(body) == CONS_TYPE) {
+        SchemeItem *form = body->car;
+        if (isForm(form, DEFINE_FORM) && typeOf(form->cdr) == CONS_TYPE && typeOf(form->cdr->car) == SYMBOL_TYPE) {
+            addName(scope, form->cdr->car);
+        } else if (isForm(form, BEGIN_FORM)) {
+            addDefines(scope, form->cdr);
+        }
+        body = body->cdr;
+    }
+}
+
+// Marks in uses how the scope's variables turn up in an unanalyzed expression:
+// mentioned somewhere inside a lambda, or set! (or defined over). Inner scopes that shadow a name
+// aren't noticed, which can only make a variable look used when it isn't.
+void noteUses(Scope *scope, char *uses, SchemeItem *expr, bool in_lambda) {
+    if (typeOf(expr) == SYMBOL_TYPE) {
+        int index = findName(scope, expr);
+        if (index != -1 && in_lambda) {
+            uses[index] |= USED_IN_LAMBDA;
+        }
+        return;
+    }
+    if (typeOf(expr) != CONS_TYPE || isForm(expr, QUOTE_FORM)) {
+        return;
+    }
+    if ((isForm(expr, SET_FORM) || isForm(expr, DEFINE_FORM)) && typeOf(expr->cdr) == CONS_TYPE) {
+        int index = findName(scope, expr->cdr->car);
+        if (index != -1) {
+            uses[index] |= ASSIGNED;
+        }
+    }
+
+    in_lambda = in_lambda || isForm(expr, LAMBDA_FORM);
+    while (typeOf(expr) == CONS_TYPE) {
+        noteUses(scope, uses, expr->car, in_lambda);
+        expr = expr->cdr;
+    }
+    noteUses(scope, uses, expr, in_lambda);
+}
+
+// Decides which of the scope's variables live in boxes, from how they are used
+// in the inits of a letrec's bindings (or an empty list) and in a body. A closure copies the values
+// it captures, so a variable that can change after a closure has copied it has
+// to be shared through a box instead: a captured variable that is set!, or one
+// that a closure can capture before it has its value (a letrec variable or an
+// internal define). The first bound variables are the ones that have their
+// values as soon as the scope is entered.
+void findBoxes(Scope *scope, int bound, SchemeItem *bindings, SchemeItem *body) {
+    char *uses = scopeAlloc(scope->count);
+    memset(uses, 0, scope->count);
+    for (; typeOf(bindings) == CONS_TYPE; bindings = bindings->cdr) {
+        noteUses(scope, uses, bindings->car->cdr->car, false);
+    }
+    for (; typeOf(body) == CONS_TYPE; body = body->cdr) {
+        noteUses(scope, uses, body->car, false);
+    }
+    for (int i = 0; i < scope->count; i++) {
+        if (i < bound) {
+            scope->boxed[i] = uses[i] == (USED_IN_LAMBDA | ASSIGNED);
+        } else {
+            scope->boxed[i] = (uses[i] & USED_IN_LAMBDA) != 0;
+        }
+    }
+    scope->uses = uses;
+}
+
+// Puts a MAKEBOX_TYPE node for each of the scope's boxed variables in front of
+// an analyzed body, so their slots are boxed before anything else runs
+SchemeItem *addBoxes(Scope *scope, SchemeItem *body) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(body);
+
+    for (int i = scope->count - 1; i >= 0; i--) {
+        if (scope->boxed[i]) {
+            SchemeItem *box = makeItem(MAKEBOX_TYPE);
+            box->symbol = scope->names[i];
+            box->index = i;
+            body = cons(box, body);
+        }
+    }
+
+    gcRestoreRoots(roots);
+    return body;
+}
+
+// Adds a variable from outside a lambda to its closure scope, and returns its
+// index there. The variable is resolved from where the lambda is, which captures
+// it into any closure scopes further out along the way. Returns -1 if it is a
+// global, which closures don't capture.
+int capture(Scope *closure, SchemeItem *symbol) {
+    SchemeItem *outer = resolve(symbol, closure->parent);
+    if (typeOf(outer) == GLOBAL_TYPE) {
+        return -1;
+    }
+    bool boxed = typeOf(outer) == BOXED_TYPE;
+    closure->captures = cons(outer, closure->captures);
+
+    if (closure->count == closure->capacity) {
+        SchemeItem **names = scopeAlloc(2 * closure->capacity * sizeof(SchemeItem *));
+        bool *slots_boxed = scopeAlloc(2 * closure->capacity * sizeof(bool));
+        memcpy(names, closure->names, closure->count * sizeof(SchemeItem *));
+        memcpy(slots_boxed, closure->boxed, closure->count * sizeof(bool));
+        free(closure->names);
+        free(closure->boxed);
+        closure->names = names;
+        closure->boxed = slots_boxed;
+        closure->capacity = 2 * closure->capacity;
+    }
+    addName(closure, symbol);
+    closure->boxed[closure->count - 1] = boxed;
+    return closure->count - 1;
+}
+
+// Resolves a variable to the slot of the innermost scope that binds it, or to a
+// global if no scope does. Past a lambda, the variable is one the lambda captures.
+SchemeItem *resolve(SchemeItem *symbol, Scope *scope) {
+    int depth = 0;
+    while (scope != NULL) {
+        int index = findName(scope, symbol);
+        if (index == -1 && scope->closure) {
+            index = capture(scope, symbol);
+        }
+        if (index != -1) {
+            SchemeItem *reference = makeItem(scope->boxed[index] ? BOXED_TYPE : LOCAL_TYPE);
+            reference->symbol = symbol;
+            reference->depth = depth;
+            reference->index = index;
+            return reference;
+        }
+        if (scope->closure) {
+            break;
+        }
+        depth++;
+        scope = scope->parent;
+    }
+
+    SchemeItem *reference = makeItem(GLOBAL_TYPE);
+    reference->symbol = symbol;
+    return reference;
+}
+
+// Makes a FOLDED_TYPE node for an expression that comes out to value as long as
+// no primitive is redefined
+SchemeItem *makeFolded(SchemeItem *value, SchemeItem *original) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(value);
+    GC_ROOT(original);
+    SchemeItem *folded = makeItem(FOLDED_TYPE);
+    gcRestoreRoots(roots);
+
+    folded->folded = value;
+    folded->original = original;
+    folded->redefinitions = primitiveRedefinitions();
+    return folded;
+}
+
+// Returns the value of an analyzed expression that is a constant (a literal, a
+// quote or a folded call), or NULL if it isn't one. Never allocates.
+SchemeItem *constantValue(SchemeItem *expr) {
+    switch (typeOf(expr)) {
+        case INT_TYPE:
+        case BIGNUM_TYPE:
+        case VECTOR_TYPE:
+        case DOUBLE_TYPE:
+        case STR_TYPE:
+        case BOOL_TYPE:
+            return expr;
+        case FOLDED_TYPE:
+            return expr->folded;
+        default:
+            return isForm(expr, QUOTE_FORM) ? expr->cdr->car : NULL;
+    }
+}
+
+// Folds an analyzed call into its value, if the operator is a global holding a
+// foldable primitive and every argument is a constant it accepts. The primitive
+// is called right here; the call is kept in the node in case the global changes.
+SchemeItem *foldCall(SchemeItem *call) {
+    if (typeOf(call->car) != GLOBAL_TYPE) {
+        return call;
+    }
+    // the pair never moves, but the primitive in it can
+    SchemeItem *pair = findGlobalBinding(call->car->symbol);
+    if (pair == NULL || typeOf(pair->cdr) != PRIMITIVE_TYPE || pair->cdr->canFold == NULL) {
+        return call;
+    }
+    for (SchemeItem *current = call->cdr; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        if (constantValue(current->car) == NULL) {
+            return call;
+        }
+    }
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(call);
+    SchemeItem *args = makeEmpty();
+    GC_ROOT(args);
+    SchemeItem *current = call->cdr;
+    GC_ROOT(current);
+    while (typeOf(current) == CONS_TYPE) {
+        args = cons(constantValue(current->car), args);
+        current = current->cdr;
+    }
+    args = reverse(args);
+
+    SchemeItem *result = call;
+    if (pair->cdr->canFold(args)) {
+        result = makeFolded(pair->cdr->pf(args), call);
+    }
+    gcRestoreRoots(roots);
+    return result;
+}
+
+// Analyzes a variable reference. A let variable that is never set! and is bound
+// to an immediate constant (a number, boolean or empty list) is replaced by it,
+// or if it came from a folded call, by a folded node for the variable.
+SchemeItem *analyzeReference(SchemeItem *symbol, Scope *scope) {
+    for (Scope *current = scope; current != NULL; current = current->parent) {
+        int index = current->closure ? -1 : findName(current, symbol);
+        if (index == -1) {
+            continue;
+        }
+        if (current->constants == NULL || current->constants[index] == NULL) {
+            break;
+        }
+        if (!current->guarded[index]) {
+            return current->constants[index];
+        }
+        return makeFolded(current->constants[index], resolve(symbol, scope));
+    }
+    return resolve(symbol, scope);
+}
+
+// Notes which variables of a let stand for constants (see analyzeReference),
+// from their analyzed (NAME . INIT) bindings
+void findConstants(Scope *scope, SchemeItem *inits) {
+    scope->constants = scopeAlloc(scope->count * sizeof(SchemeItem *));
+    scope->guarded = scopeAlloc(scope->count * sizeof(bool));
+    for (int i = 0; i < scope->count; i++) {
+        scope->constants[i] = NULL;
+        scope->guarded[i] = false;
+        if (typeOf(inits) != CONS_TYPE) {
+            continue;
+        }
+        SchemeItem *init = inits->car->cdr;
+        SchemeItem *value = constantValue(init);
+        if (value != NULL && isImmediate(value) && (scope->uses[i] & ASSIGNED) == 0) {
+            scope->constants[i] = value;
+            scope->guarded[i] = typeOf(init) == FOLDED_TYPE;
+        }
+        inits = inits->cdr;
+    }
+}
+
+// Analyzes every expression in a proper list, returning the list of results
+SchemeItem *analyzeSequence(SchemeItem *exprs, Scope *scope) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(exprs);
+
+    SchemeItem *analyzed = makeEmpty();
+    GC_ROOT(analyzed);
+
+    while (typeOf(exprs) == CONS_TYPE) {
+        SchemeItem *item = analyzeExpr(exprs->car, scope);
+        analyzed = cons(item, analyzed);
+        exprs = exprs->cdr;
+    }
+    if (typeOf(exprs) != EMPTY_TYPE) {
+        printf("Evaluation error: expression is not a proper list\n");
+        texit(1);
+    }
+
+    analyzed = reverse(analyzed);
+    gcRestoreRoots(roots);
+    return analyzed;
+}
+
+// Builds the list (keyword first second)
+SchemeItem *makeForm(SchemeItem *keyword, SchemeItem *first, SchemeItem *second) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(first);
+    GC_ROOT(second);
+
+    SchemeItem *rest = makeEmpty();
+    rest = cons(second, rest);
+    rest = cons(first, rest);
+
+    gcRestoreRoots(roots);
+    return cons(keyword, rest);
+}
+
+// Checks a binding list for let or letrec: a list of (symbol expression) pairs
+void checkBindings(SchemeItem *bindings) {
+    if (typeOf(bindings) != CONS_TYPE && typeOf(bindings) != EMPTY_TYPE) {
+        printf("Evaluation error: let bindings must be a list\n");
+        texit(1);
+    }
+    while (typeOf(bindings) == CONS_TYPE) {
+        SchemeItem *binding = bindings->car;
+        if (typeOf(binding) != CONS_TYPE) {
+            printf("Evaluation error: null binding in let.\n");
+            texit(1);
+        }
+        if (typeOf(binding->car) != SYMBOL_TYPE) {
+            printf("Evaluation error: let variable symbol is not a symbol.\n");
+            texit(1);
+        }
+        if (length(binding) != 2) {
+            printf("Evaluation error: let binding must have exactly one expression.\n");
+            texit(1);
+        }
+        bindings = bindings->cdr;
+    }
+}
+
+// Analyzes (let ((name init) ...) body...) or the letrec equivalent into
+// (let SIZE ((NAME . INIT)...) BODY...). The inits of a let are analyzed in the
+// enclosing scope; a letrec's see its own variables.
+SchemeItem *analyzeLet(SchemeItem *expr, Scope *scope, bool recursive) {
+    SchemeItem *keyword = expr->car;
+    SchemeItem *args = expr->cdr;
+    if (typeOf(args) != CONS_TYPE || typeOf(args->cdr) != CONS_TYPE) {
+        printf("Evaluation error: let body is empty.\n");
+        texit(1);
+    }
+    SchemeItem *bindings = args->car;
+    SchemeItem *body = args->cdr;
+    checkBindings(bindings);
+
+    Scope inner = makeScope(scope, length(bindings) + countDefines(body));
+    for (SchemeItem *current = bindings; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        SchemeItem *name = current->car->car;
+        SchemeItem *init = current->car->cdr->car;
+        // letrec can't initialize one variable straight from another
+        if (recursive && typeOf(init) == SYMBOL_TYPE && init != name) {
+            printf("Evaluation Error\n");
+            texit(1);
+        }
+        addName(&inner, name);
+    }
+    int bound = inner.count;
+    addDefines(&inner, body);
+    findBoxes(&inner, recursive ? 0 : bound, recursive ? bindings : makeEmpty(), body);
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(body);
+
+    SchemeItem *current = bindings;
+    GC_ROOT(current);
+    SchemeItem *inits = makeEmpty();
+    GC_ROOT(inits);
+    while (typeOf(current) == CONS_TYPE) {
+        SchemeItem *init = analyzeExpr(current->car->cdr->car, recursive ? &inner : scope);
+        SchemeItem *binding = cons(current->car->car, init);
+        inits = cons(binding, inits);
+        current = current->cdr;
+    }
+    inits = reverse(inits);
+    if (!recursive) {
+        findConstants(&inner, inits);
+    }
+
+    body = analyzeSequence(body, &inner);
+    body = addBoxes(&inner, body);
+
+    SchemeItem *result = cons(inits, body);
+    result = cons(makeFixnum(inner.count), result);
+    freeScope(&inner);
+
+    gcRestoreRoots(roots);
+    return cons(keyword, result);
+}
+
+// Analyzes (lambda params body...) into a LAMBDA_TYPE node. The parameters can be
+// a list of symbols, a single symbol that collects every argument, or a list ending
+// in a dotted symbol that collects the rest. The node also lists where each variable
+// the lambda captures is, as seen from where the lambda is.
+SchemeItem *analyzeLambda(SchemeItem *expr, Scope *scope) {
+    SchemeItem *args = expr->cdr;
+    if (length(args) < 2) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    SchemeItem *params = args->car;
+    SchemeItem *body = args->cdr;
+
+    int param_count = 0;
+    SchemeItem *current = params;
+    while (typeOf(current) == CONS_TYPE) {
+        if (typeOf(current->car) != SYMBOL_TYPE) {
+            printf("Evaluation error\n");
+            texit(1);
+        }
+        param_count++;
+        current = current->cdr;
+    }
+    bool rest = typeOf(current) == SYMBOL_TYPE;
+    if (!rest && typeOf(current) != EMPTY_TYPE) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+
+    Scope closure = makeScope(scope, 4);
+    closure.closure = true;
+    Scope inner = makeScope(&closure, param_count + (rest ? 1 : 0) + countDefines(body));
+    for (current = params; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        if (findName(&inner, current->car) != -1) {
+            printf("Evaluation error: duplicate identifier\n");
+            texit(1);
+        }
+        addName(&inner, current->car);
+    }
+    if (rest) {
+        if (findName(&inner, current) != -1) {
+            printf("Evaluation error: duplicate identifier\n");
+            texit(1);
+        }
+        addName(&inner, current);
+    }
+    int bound = inner.count;
+    addDefines(&inner, body);
+    findBoxes(&inner, bound, makeEmpty(), body);
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(closure.captures);
+
+    body = analyzeSequence(body, &inner);
+    body = addBoxes(&inner, body);
+    GC_ROOT(body);
+    SchemeItem *captures = reverse(closure.captures);
+    GC_ROOT(captures);
+    SchemeItem *lambda = makeItem(LAMBDA_TYPE);
+    gcRestoreRoots(roots);
+
+    lambda->body = body;
+    lambda->captures = captures;
+    lambda->paramCount = param_count;
+    lambda->frameSize = inner.count;
+    lambda->rest = rest;
+    freeScope(&inner);
+    freeScope(&closure);
+    return lambda;
+}
+
+// Analyzes (define name expr). At the top level this defines a global; inside a
+// body, name already has a slot in the body's scope (see addDefines).
+SchemeItem *analyzeDefine(SchemeItem *expr, Scope *scope) {
+    SchemeItem *args = expr->cdr;
+    if (length(args) != 2) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    SchemeItem *name = args->car;
+    if (typeOf(name) != SYMBOL_TYPE) {
+        printf("Evaluation error: define name must be a symbol\n");
+        texit(1);
+    }
+    if (scope != NULL && findName(scope, name) == -1) {
+        printf("Evaluation error: define is only allowed at the start of a body\n");
+        texit(1);
+    }
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(expr);
+
+    SchemeItem *target = resolve(name, scope);
+    GC_ROOT(target);
+    SchemeItem *value = analyzeExpr(expr->cdr->cdr->car, scope);
+
+    gcRestoreRoots(roots);
+    return makeForm(expr->car, target, value);
+}
+
+// Analyzes (set! name expr)
+SchemeItem *analyzeSet(SchemeItem *expr, Scope *scope) {
+    SchemeItem *args = expr->cdr;
+    if (length(args) != 2) {
+        printf("Evaluation error: set! takes 2 arguments\n");
+        texit(1);
+    }
+    if (typeOf(args->car) != SYMBOL_TYPE) {
+        printf("Evaluation error: set! name must be a symbol\n");
+        texit(1);
+    }
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(expr);
+
+    SchemeItem *target = resolve(args->car, scope);
+    GC_ROOT(target);
+    SchemeItem *value = analyzeExpr(expr->cdr->cdr->car, scope);
+
+    gcRestoreRoots(roots);
+    return makeForm(expr->car, target, value);
+}
+
+// Analyzes (cond (test body...) ... (else body...)). The else symbol is kept as is.
+SchemeItem *analyzeCond(SchemeItem *expr, Scope *scope) {
+    SchemeItem *else_symbol = intern("else");
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(expr);
+
+    SchemeItem *clauses = makeEmpty();
+    GC_ROOT(clauses);
+    SchemeItem *current = expr->cdr;
+    GC_ROOT(current);
+
+    while (typeOf(current) == CONS_TYPE) {
+        SchemeItem *clause = current->car;
+        if (typeOf(clause) != CONS_TYPE) {
+            printf("Evaluation error: cond clause must be a list\n");
+            texit(1);
+        }
+
+        SchemeItem *analyzed;
+        if (clause->car == else_symbol) {
+            analyzed = analyzeSequence(clause->cdr, scope);
+            analyzed = cons(else_symbol, analyzed);
+        } else {
+            analyzed = analyzeSequence(clause, scope);
+        }
+        clauses = cons(analyzed, clauses);
+        current = current->cdr;
+    }
+    clauses = reverse(clauses);
+
+    gcRestoreRoots(roots);
+    return cons(expr->car, clauses);
+}
+
+// Analyzes any expression in the given scope
+SchemeItem *analyzeExpr(SchemeItem *expr, Scope *scope) {
+    switch (typeOf(expr)) {
+        case INT_TYPE:
+        case BIGNUM_TYPE:
+        case VECTOR_TYPE:
+        case DOUBLE_TYPE:
+        case STR_TYPE:
+        case BOOL_TYPE:
+            return expr;
+        case SYMBOL_TYPE:
+            return analyzeReference(expr, scope);
+        case EMPTY_TYPE:
+            printf("Evaluation error: cannot evaluate empty list\n");
+            texit(1);
+        case CONS_TYPE:
+            break;
+        default:
+            printf("Evaluation error: SchemeItem doesn't have a type\n");
+            texit(1);
+    }
+
+    SchemeItem *first = expr->car;
+    if (typeOf(first) != SYMBOL_TYPE || first->form == NOT_SPECIAL) {
+        // procedure call: the operator and the arguments are all just expressions
+        return foldCall(analyzeSequence(expr, scope));
+    }
+
+    switch (first->form) {
+        case QUOTE_FORM:
+            if (length(expr->cdr) != 1) {
+                printf("Evaluation error\n");
+                texit(1);
+            }
+            return expr;
+        case IF_FORM: {
+            if (length(expr->cdr) != 3) {
+                printf("Evaluation error: args length isn't 3.\n");
+                texit(1);
+            }
+            SchemeItem *args = analyzeSequence(expr->cdr, scope);
+            // a test that is a plain constant (not a folded call) decides the branch now
+            if (typeOf(args->car) != FOLDED_TYPE && constantValue(args->car) != NULL) {
+                return isFalse(constantValue(args->car)) ? args->cdr->cdr->car : args->cdr->car;
+            }
+            return cons(first, args);
+        }
+        case BEGIN_FORM:
+        case AND_FORM:
+        case OR_FORM:
+            return cons(first, analyzeSequence(expr->cdr, scope));
+        case LET_FORM:
+            return analyzeLet(expr, scope, false);
+        case LETREC_FORM:
+            return analyzeLet(expr, scope, true);
+        case LAMBDA_FORM:
+            return analyzeLambda(expr, scope);
+        case DEFINE_FORM:
+            return analyzeDefine(expr, scope);
+        case SET_FORM:
+            return analyzeSet(expr, scope);
+        case COND_FORM:
+            return analyzeCond(expr, scope);
+        default:
+            printf("Evaluation error\n");
+            texit(1);
+    }
+    return NULL;
+}
+
+// Analyzes one top-level form (see analyzer.h)
+SchemeItem *analyze(SchemeItem *tree) {
+    return analyzeExpr(tree, NULL);
+}
@@ -0,0 +1,43 @@
+#include "schemeitem.h"
+
+#ifndef _ANALYZER
+#define _ANALYZER
+
+// Takes one top-level form from the parse tree, checks the syntax of every
+// special form in it, and returns a tree that eval can run without checking
+// anything again:
+//
+// - Every variable reference becomes a LOCAL_TYPE node holding the (depth,
+//   index) of its slot, counting frames outward from the current one, or a
+//   GLOBAL_TYPE node holding its symbol if it isn't bound in any enclosing
+//   scope. A variable whose slot holds a box gets a BOXED_TYPE node instead.
+// - Every lambda becomes a LAMBDA_TYPE node that knows how many slots its
+//   frame needs (its parameters plus any internal defines), and which
+//   variables from outside it captures: a list of LOCAL_TYPE or BOXED_TYPE
+//   nodes for them, resolved where the lambda is. Inside the lambda, the
+//   captured variables are the slots of the frame just outside its own, so
+//   finding one never walks further than the frames of the lambda itself.
+// - Captured variables are copied into the closure. The ones that could still
+//   change after that (set! ones, letrec variables and internal defines) are
+//   kept in boxes, which the closure shares. A body whose scope has any starts
+//   with a MAKEBOX_TYPE node for each, holding the index of a slot to box.
+// - let and letrec become (let SIZE ((NAME . INIT)...) BODY...), where SIZE is
+//   an INT_TYPE item with the number of slots in the new frame. The names are
+//   only kept to name the closures an init makes.
+// - define and set! take a LOCAL_TYPE, BOXED_TYPE or GLOBAL_TYPE node instead
+//   of a symbol.
+// - A call of a global that holds a foldable primitive, on arguments that are
+//   all constants, is made right away, and becomes a FOLDED_TYPE node with the
+//   result. Each primitive decides which arguments it folds on (canFold), so a
+//   call that would be an error, like (car '()), is left to fail when it runs.
+//   The node keeps the call too: once set! has changed a global that held a
+//   primitive, eval runs that instead (see primitiveRedefinitions). A local
+//   that shadows the primitive's name is never a global, so it isn't folded.
+// - An if whose test is a literal or quote is replaced by the branch it takes.
+// - A let variable that is never set! and is bound to an immediate constant
+//   (literal or folded) is replaced by it wherever it is used.
+//
+// Quoted data is left untouched. Syntax errors are reported here.
+SchemeItem *analyze(SchemeItem *tree);
+
+#endif
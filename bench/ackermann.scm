@@ -0,0 +1,11 @@
+; Ackermann's function: very deep recursion
+(define ack
+  (lambda (m n)
+    (cond ((equal? m 0) (+ n 1))
+          ((equal? n 0) (ack (+ m -1) 1))
+          (else (ack (+ m -1) (ack m (+ n -1)))))))
+
+(display (ack 2 9))
+(newline)
+(display (ack 3 7))
+(newline)
@@ -0,0 +1,43 @@
+; Makes and calls lots of closures, with state kept in captured variables
+(define make-adder
+  (lambda (n)
+    (lambda (x) (+ x n))))
+
+(define compose
+  (lambda (f g)
+    (lambda (x) (f (g x)))))
+
+(define make-counter
+  (lambda ()
+    (let ((count 0))
+      (lambda ()
+        (set! count (+ count 1))
+        count))))
+
+(define apply-n
+  (lambda (f n x)
+    (if (equal? n 0)
+        x
+        (apply-n f (+ n -1) (f x)))))
+
+(define add3 (compose (make-adder 1) (make-adder 2)))
+(display (apply-n add3 300000 0))
+(newline)
+
+(define counter (make-counter))
+(define tick
+  (lambda (n)
+    (if (equal? n 0)
+        (counter)
+        (begin (counter) (tick (+ n -1))))))
+(display (tick 300000))
+(newline)
+
+; a fresh closure on every iteration
+(define fresh
+  (lambda (n acc)
+    (if (equal? n 0)
+        acc
+        (fresh (+ n -1) ((make-adder n) acc)))))
+(display (fresh 300000 0))
+(newline)
@@ -0,0 +1,9 @@
+; Doubly recursive Fibonacci: calls, arithmetic and comparisons
+(define fib
+  (lambda (n)
+    (if (< n 2)
+        n
+        (+ (fib (+ n -1)) (fib (+ n -2))))))
+
+(display (fib 27))
+(newline)
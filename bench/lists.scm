@@ -0,0 +1,44 @@
+; Builds, reverses and appends long lists
+(define build
+  (lambda (n acc)
+    (if (equal? n 0)
+        acc
+        (build (+ n -1) (cons n acc)))))
+
+(define rev
+  (lambda (lst acc)
+    (if (null? lst)
+        acc
+        (rev (cdr lst) (cons (car lst) acc)))))
+
+(define len
+  (lambda (lst acc)
+    (if (null? lst)
+        acc
+        (len (cdr lst) (+ acc 1)))))
+
+(define sum
+  (lambda (lst acc)
+    (if (null? lst)
+        acc
+        (sum (cdr lst) (+ acc (car lst))))))
+
+; appends a copy of the small list onto the big one, times times
+(define grow
+  (lambda (big small times)
+    (if (equal? times 0)
+        big
+        (grow (append small big) small (+ times -1)))))
+
+(define big (build 100000 (quote ())))
+(display (car (rev big (quote ()))))
+(newline)
+(display (len (grow big (build 100 (quote ())) 2000) 0))
+(newline)
+(define rounds
+  (lambda (n total)
+    (if (equal? n 0)
+        total
+        (rounds (+ n -1) (+ total (sum (rev big (quote ())) 0))))))
+(display (rounds 5 0))
+(newline)
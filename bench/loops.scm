@@ -0,0 +1,29 @@
+; let and letrec loops
+(define count-to
+  (lambda (n)
+    (letrec ((loop (lambda (i acc)
+                     (if (equal? i n)
+                         acc
+                         (let ((next (+ i 1))
+                               (total (+ acc i)))
+                           (loop next total))))))
+      (loop 0 0))))
+
+(display (count-to 1000000))
+(newline)
+
+(define nested
+  (lambda (outer)
+    (letrec ((rows (lambda (i acc)
+                     (if (equal? i outer)
+                         acc
+                         (rows (+ i 1)
+                               (letrec ((cols (lambda (j acc)
+                                                (if (equal? j 100)
+                                                    acc
+                                                    (cols (+ j 1) (+ acc 1))))))
+                                 (cols 0 acc)))))))
+      (rows 0 0))))
+
+(display (nested 5000))
+(newline)
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Runs a command and writes its peak RSS in KB to a file, like time -f %M. The
+// benchmarks run every engine through this, so they're all measured the same
+// way: a child's ru_maxrss includes whatever its parent had mapped before the
+// exec, and this process is much smaller than the python that runs it.
+//
+// usage: maxrss FILE COMMAND [ARGUMENT...]
+// Exits with the command's status, or 128 plus the signal that killed it.
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: maxrss FILE COMMAND [ARGUMENT...]\n");
+        return 2;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("maxrss: fork");
+        return 2;
+    }
+    if (pid == 0) {
+        execvp(argv[2], argv + 2);
+        perror("maxrss: exec");
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("maxrss: wait4");
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if (file == NULL) {
+        perror("maxrss: fopen");
+        return 2;
+    }
+    fprintf(file, "%ld\n", usage.ru_maxrss);
+    fclose(file);
+
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,31 @@
+; Counts the solutions to the n queens problem by backtracking over lists
+(define count-up
+  (lambda (n acc)
+    (if (equal? n 0)
+        acc
+        (count-up (+ n -1) (cons n acc)))))
+
+; Can a queen go in row, dist columns away from the last queen in placed?
+(define ok?
+  (lambda (row dist placed)
+    (cond ((null? placed) #t)
+          ((equal? (car placed) (+ row dist)) #f)
+          ((equal? row (+ (car placed) dist)) #f)
+          (else (ok? row (+ dist 1) (cdr placed))))))
+
+; candidates: rows still to try, skipped: rows tried and put back, placed: the queens so far
+(define try
+  (lambda (candidates skipped placed)
+    (if (null? candidates)
+        (if (null? skipped) 1 0)
+        (+ (if (ok? (car candidates) 1 placed)
+               (try (append (cdr candidates) skipped) (quote ()) (cons (car candidates) placed))
+               0)
+           (try (cdr candidates) (cons (car candidates) skipped) placed)))))
+
+(define queens
+  (lambda (n)
+    (try (count-up n (quote ())) (quote ()) (quote ()))))
+
+(display (queens 10))
+(newline)
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+
+# Runs the benchmarks in bench/ and prints one JSON object per benchmark and
+# engine on stdout, with the wall time, peak RSS and allocation counts.
+#
+# Engines are "tree" (the tree-walking evaluator), "vm" (--vm) and "guile" (the
+# reference implementation, through the scheme script). Each benchmark's output
+# is checked against its .output file, so a fast wrong answer doesn't count.
+# Every engine runs under bench/maxrss.c (built with cc into a temporary
+# directory), which reports its peak RSS the way time -f %M does.
+#
+# usage: bench/run.py [--interpreter PATH] [--engines tree,vm,guile] [--repeat N] [BENCHMARK...]
+
+import argparse
+import json
+import os
+import re
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(BENCH_DIR)
+TIMEOUT = 300
+
+# The generated benchmark: a large source file of small definitions and one big
+# quoted list, to measure reading and analysis as much as evaluation.
+GENERATED_FUNCTIONS = 5000
+GENERATED_DATA = 50000
+
+
+def write_generated(directory):
+    '''Writes generated.scm and its expected output into directory, and returns the path.'''
+    path = os.path.join(directory, 'generated.scm')
+    with open(path, 'w') as source:
+        source.write('; generated by bench/run.py\n')
+        for i in range(GENERATED_FUNCTIONS):
+            source.write('(define f%d (lambda (x) (+ x %d)))\n' % (i, i))
+        source.write('(define total 0)\n')
+        for i in range(GENERATED_FUNCTIONS):
+            source.write('(set! total (f%d total))\n' % i)
+        source.write('(display total)\n(newline)\n')
+
+        source.write('(define data (quote (')
+        source.write(' '.join(str(i) for i in range(GENERATED_DATA)))
+        source.write(')))\n')
+        source.write('(define sum (lambda (lst acc) (if (null? lst) acc (sum (cdr lst) (+ acc (car lst))))))\n')
+        source.write('(display (sum data 0))\n(newline)\n')
+
+    with open(os.path.join(directory, 'generated.output'), 'w') as output:
+        output.write('%d\n' % sum(range(GENERATED_FUNCTIONS)))
+        output.write('%d\n' % sum(range(GENERATED_DATA)))
+    return path
+
+
+def build_maxrss(directory):
+    '''Compiles bench/maxrss.c into directory, and returns the path of the program.'''
+    path = os.path.join(directory, 'maxrss')
+    subprocess.run(['cc', '-O2', '-o', path, os.path.join(BENCH_DIR, 'maxrss.c')], check=True)
+    return path
+
+
+def run_once(maxrss, command, path):
+    '''Runs command with the file at path as its last argument, under maxrss.
+
+    Returns a dict with the output, stderr, wall time, peak RSS and a status.'''
+    with tempfile.TemporaryFile() as output, tempfile.TemporaryFile() as errors, \
+            tempfile.NamedTemporaryFile(mode='r') as rss:
+        start = time.perf_counter()
+        # in its own session, so a timeout kills the command along with maxrss
+        process = subprocess.Popen([maxrss, rss.name] + command + [path], stdin=subprocess.DEVNULL,
+                                   stdout=output, stderr=errors, start_new_session=True)
+        timer = threading.Timer(TIMEOUT, os.killpg, (process.pid, signal.SIGKILL))
+        timer.start()
+        process.wait()
+        seconds = time.perf_counter() - start
+        timer.cancel()
+
+        output.seek(0)
+        errors.seek(0)
+        result = {
+            'output': output.read().decode(errors='replace'),
+            'stderr': errors.read().decode(errors='replace'),
+            'seconds': seconds,
+            'max_rss_kb': int(rss.read() or 0),
+        }
+
+    if seconds >= TIMEOUT:
+        result['status'] = 'timed out'
+    elif process.returncode != 0:
+        result['status'] = 'exit %d' % process.returncode
+    else:
+        result['status'] = 'ok'
+    return result
+
+
+def parse_gc_stats(stderr):
+    '''Pulls the key=value counters out of the interpreter's --gc-stats line.
+
+    Its own max_rss_kb is left out, since Guile has nothing to compare it with.'''
+    match = re.search(r'^gc-stats: (.*)$', stderr, re.MULTILINE)
+    if match is None:
+        return {}
+    return {key: int(value) for key, value in re.findall(r'(\w+)=(\d+)', match.group(1))
+            if key != 'max_rss_kb'}
+
+
+def engine_command(engine, interpreter):
+    '''Returns the command line for an engine, or None if it can't run here.'''
+    if engine == 'tree':
+        return [interpreter, '--gc-stats']
+    if engine == 'vm':
+        return [interpreter, '--vm', '--gc-stats']
+    if engine == 'guile':
+        if shutil.which('guile') is None:
+            return None
+        return [os.path.join(REPO_DIR, 'scheme')]
+    raise ValueError('unknown engine ' + engine)
+
+
+def run_benchmark(maxrss, name, path, expected, engine, command, repeat):
+    '''Runs one benchmark on one engine repeat times, and returns its record.
+
+    The time and RSS are from the fastest run.'''
+    record = {'benchmark': name, 'engine': engine}
+    if command is None:
+        record['status'] = 'skipped'
+        return record
+
+    best = None
+    for _ in range(repeat):
+        result = run_once(maxrss, command, path)
+        if result['status'] == 'ok' and result['output'] != expected:
+            result['status'] = 'wrong output'
+        if result['status'] != 'ok':
+            best = result
+            break
+        if best is None or result['seconds'] < best['seconds']:
+            best = result
+
+    record['status'] = best['status']
+    record['seconds'] = round(best['seconds'], 4)
+    record['max_rss_kb'] = best['max_rss_kb']
+    record.update(parse_gc_stats(best['stderr']))
+    return record
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Runs the Scheme benchmarks in bench/.')
+    parser.add_argument('--interpreter', default=os.path.join(REPO_DIR, 'interpreter'))
+    parser.add_argument('--engines', default='tree,vm,guile')
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('benchmarks', nargs='*')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        maxrss = build_maxrss(directory)
+        paths = {}
+        for file in sorted(os.listdir(BENCH_DIR)):
+            if file.endswith('.scm'):
+                paths[file[:-4]] = os.path.join(BENCH_DIR, file)
+        paths['generated'] = write_generated(directory)
+
+        names = args.benchmarks if args.benchmarks else list(paths)
+        failed = False
+        for name in names:
+            if name not in paths:
+                sys.exit('no benchmark named ' + name)
+            path = paths[name]
+            with open(path[:-4] + '.output') as output:
+                expected = output.read()
+
+            for engine in args.engines.split(','):
+                command = engine_command(engine, args.interpreter)
+                record = run_benchmark(maxrss, name, path, expected, engine, command, args.repeat)
+                print(json.dumps(record), flush=True)
+                failed = failed or record['status'] not in ('ok', 'skipped')
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
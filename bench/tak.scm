@@ -0,0 +1,17 @@
+; Takeuchi's function: deep non-tail recursion with three arguments
+(define tak
+  (lambda (x y z)
+    (if (< y x)
+        (tak (tak (+ x -1) y z)
+             (tak (+ y -1) z x)
+             (tak (+ z -1) x y))
+        z)))
+
+(define repeat
+  (lambda (n result)
+    (if (equal? n 0)
+        result
+        (repeat (+ n -1) (tak 18 12 6)))))
+
+(display (repeat 10 0))
+(newline)
@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "gc.h"
+#include "symbols.h"
+#include "vm.h"
+#include "compiler.h"
+
+// The state for compiling one Code. The instructions are collected in a malloc'ed
+// array that grows as needed, then copied into the code once it is done; the
+// constants go straight into the code. depth tracks how many values the code has
+// on the stack at the current instruction.
+//
+// Code is allocated with gcAllocOldNoCollect, so compiling never collects, and
+// nothing here needs rooting: neither the tree, which may still be young, nor
+// the code made so far.
+typedef struct Compiler {
+    Code *code;
+    int *instructions;
+    int count;
+    int capacity;
+    int constant_capacity;
+    int depth;
+    int max_depth;
+} Compiler;
+
+Code *compileLambda(SchemeItem *lambda);
+void compileExpr(Compiler *compiler, SchemeItem *expr, bool tail);
+void compileBinding(Compiler *compiler, SchemeItem *expr, SchemeItem *name);
+
+// Appends one word (an opcode or operand) to the instructions
+void emit(Compiler *compiler, int word) {
+    if (compiler->count == compiler->capacity) {
+        compiler->capacity = compiler->capacity == 0 ? 64 : compiler->capacity * 2;
+        compiler->instructions = realloc(compiler->instructions, compiler->capacity * sizeof(int));
+        if (compiler->instructions == NULL) {
+            printf("Error: out of memory\n");
+            exit(1);
+        }
+    }
+    compiler->instructions[compiler->count++] = word;
+}
+
+// Appends an opcode that changes the number of values on the stack by effect
+void emitOp(Compiler *compiler, opcode op, int effect) {
+    emit(compiler, op);
+    compiler->depth = compiler->depth + effect;
+    if (compiler->depth > compiler->max_depth) {
+        compiler->max_depth = compiler->depth;
+    }
+}
+
+// Appends a jump with a target to be filled in later by patchJump, and returns
+// where the target goes
+int emitJump(Compiler *compiler, opcode op, int effect) {
+    emitOp(compiler, op, effect);
+    emit(compiler, 0);
+    return compiler->count - 1;
+}
+
+// Points a jump from emitJump at the next instruction
+void patchJump(Compiler *compiler, int jump) {
+    compiler->instructions[jump] = compiler->count;
+}
+
+// Adds a constant to the code and returns its index
+int addConstant(Compiler *compiler, SchemeItem *item) {
+    Code *code = compiler->code;
+    if (code->constantCount == compiler->constant_capacity) {
+        compiler->constant_capacity = compiler->constant_capacity == 0 ? 8 : compiler->constant_capacity * 2;
+        SchemeItem **constants = gcAllocOldNoCollect(GC_RAW, compiler->constant_capacity * sizeof(SchemeItem *));
+        if (code->constantCount > 0) {
+            memcpy(constants, code->constants, code->constantCount * sizeof(SchemeItem *));
+        }
+        code->constants = constants;
+    }
+    code->constants[code->constantCount++] = item;
+    gcWriteBarrier(code);
+    return code->constantCount - 1;
+}
+
+// Pushes a constant
+void emitConstant(Compiler *compiler, SchemeItem *item) {
+    emitOp(compiler, OP_CONST, 1);
+    emit(compiler, addConstant(compiler, item));
+}
+
+// Returns from the code if the value just pushed is in tail position
+void emitReturn(Compiler *compiler, bool tail) {
+    if (tail) {
+        emitOp(compiler, OP_RETURN, -1);
+    }
+}
+
+// Compiles the MAKEBOX_TYPE nodes at the start of a body, and returns the rest of it
+SchemeItem *compileBoxes(Compiler *compiler, SchemeItem *body) {
+    while (typeOf(body) == CONS_TYPE && typeOf(body->car) == MAKEBOX_TYPE) {
+        emitOp(compiler, OP_BOX, 0);
+        emit(compiler, body->car->index);
+        body = body->cdr;
+    }
+    return body;
+}
+
+// Compiles a body, leaving the value of its last expression. Every other value is popped.
+void compileBody(Compiler *compiler, SchemeItem *body, bool tail) {
+    body = compileBoxes(compiler, body);
+    while (typeOf(body) == CONS_TYPE) {
+        bool last = typeOf(body->cdr) != CONS_TYPE;
+        compileExpr(compiler, body->car, tail && last);
+        if (!last) {
+            emitOp(compiler, OP_POP, -1);
+        }
+        body = body->cdr;
+    }
+}
+
+// Compiles an analyzed (let SIZE ((NAME . INIT)...) BODY...), or letrec
+void compileLet(Compiler *compiler, SchemeItem *args, bool tail, bool recursive) {
+    int size = fixnumValue(args->car);
+    SchemeItem *inits = args->cdr->car;
+    SchemeItem *body = args->cdr->cdr;
+    int count = length(inits);
+
+    if (recursive) {
+        // the boxes have to be there before any init can capture them
+        emitOp(compiler, OP_ENTER_REC, 1);
+        emit(compiler, size);
+        body = compileBoxes(compiler, body);
+        for (int index = 0; index < count; index++) {
+            compileBinding(compiler, inits->car->cdr, inits->car->car);
+            emitOp(compiler, OP_STORE_REC, -1);
+            emit(compiler, index);
+            inits = inits->cdr;
+        }
+    } else {
+        while (typeOf(inits) == CONS_TYPE) {
+            compileBinding(compiler, inits->car->cdr, inits->car->car);
+            inits = inits->cdr;
+        }
+        emitOp(compiler, OP_ENTER, 1 - count);
+        emit(compiler, size);
+        emit(compiler, count);
+    }
+
+    compileBody(compiler, body, tail);
+    if (!tail) {
+        emitOp(compiler, OP_LEAVE, -1);
+    }
+}
+
+// Allocates room for count jumps to patch, to be freed once they are patched
+int *allocJumps(int count) {
+    int *jumps = malloc((count + 1) * sizeof(int));
+    if (jumps == NULL) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    return jumps;
+}
+
+// Compiles (cond clause...). Clauses that match jump to the end with their value.
+void compileCond(Compiler *compiler, SchemeItem *clauses, bool tail) {
+    SchemeItem *else_symbol = intern("else");
+    int depth = compiler->depth;
+    int *ends = allocJumps(length(clauses));
+    int end_count = 0;
+    bool has_else = false;
+
+    while (typeOf(clauses) == CONS_TYPE) {
+        SchemeItem *clause = clauses->car;
+        compiler->depth = depth;
+        if (clause->car == else_symbol) {
+            has_else = true;
+            if (typeOf(clause->cdr) == EMPTY_TYPE) {
+                emitConstant(compiler, else_symbol); // like any other test-only clause
+                emitReturn(compiler, tail);
+            } else {
+                compileBody(compiler, clause->cdr, tail);
+            }
+            break;
+        }
+
+        compileExpr(compiler, clause->car, false);
+        if (typeOf(clause->cdr) == EMPTY_TYPE) {
+            // the test's value is the clause's value
+            ends[end_count++] = emitJump(compiler, OP_JUMP_IF_TRUE_KEEP, -1);
+        } else {
+            int next = emitJump(compiler, OP_JUMP_IF_FALSE, -1);
+            compileBody(compiler, clause->cdr, tail);
+            if (!tail) {
+                ends[end_count++] = emitJump(compiler, OP_JUMP, 0);
+            }
+            patchJump(compiler, next);
+        }
+        clauses = clauses->cdr;
+    }
+
+    if (!has_else) {
+        compiler->depth = depth;
+        emitConstant(compiler, SCHEME_VOID);
+    }
+    for (int i = 0; i < end_count; i++) {
+        patchJump(compiler, ends[i]);
+    }
+    free(ends);
+    compiler->depth = depth + 1;
+    emitReturn(compiler, tail);
+}
+
+// Compiles (and ...) or (or ...). Each expression but the last jumps to the end
+// when it decides the result.
+void compileAndOr(Compiler *compiler, SchemeItem *args, bool tail, bool is_and) {
+    if (typeOf(args) != CONS_TYPE) {
+        emitConstant(compiler, makeBool(is_and));
+        emitReturn(compiler, tail);
+        return;
+    }
+
+    int depth = compiler->depth;
+    int *ends = allocJumps(length(args));
+    int end_count = 0;
+    while (typeOf(args->cdr) == CONS_TYPE) {
+        compileExpr(compiler, args->car, false);
+        ends[end_count++] = emitJump(compiler, is_and ? OP_JUMP_IF_FALSE_KEEP : OP_JUMP_IF_TRUE_KEEP, -1);
+        args = args->cdr;
+    }
+    compileExpr(compiler, args->car, tail);
+
+    if (end_count > 0) {
+        for (int i = 0; i < end_count; i++) {
+            patchJump(compiler, ends[i]);
+        }
+        compiler->depth = depth + 1;
+        emitReturn(compiler, tail);
+    }
+    free(ends);
+}
+
+// Pushes what is in the slot of a local variable: its value, or its box
+void emitSlot(Compiler *compiler, SchemeItem *reference) {
+    if (reference->depth == 0) {
+        emitOp(compiler, OP_LOCAL0, 1);
+    } else {
+        emitOp(compiler, OP_LOCAL, 1);
+        emit(compiler, reference->depth);
+    }
+    emit(compiler, reference->index);
+    emit(compiler, addConstant(compiler, reference->symbol));
+}
+
+// Compiles a lambda into its own Code, and makes a closure of it, capturing the
+// slots of the variables it uses from outside. name is the variable the closure
+// is being bound to, if any, which the profiler reports it by
+void compileClosure(Compiler *compiler, SchemeItem *lambda, SchemeItem *name) {
+    SchemeItem *code = gcAllocOldNoCollect(GC_ITEM, sizeof(SchemeItem));
+    code->type = CODE_TYPE;
+    code->ptr = compileLambda(lambda);
+    ((Code *)code->ptr)->name = name;
+
+    int count = 0;
+    for (SchemeItem *current = lambda->captures; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        emitSlot(compiler, current->car);
+        count++;
+    }
+    emitOp(compiler, OP_CLOSURE, 1 - count);
+    emit(compiler, addConstant(compiler, code));
+    emit(compiler, count);
+}
+
+// Compiles the value of a define, let or letrec binding. A lambda written right
+// there is named after the variable
+void compileBinding(Compiler *compiler, SchemeItem *expr, SchemeItem *name) {
+    if (typeOf(expr) == LAMBDA_TYPE) {
+        compileClosure(compiler, expr, name);
+    } else {
+        compileExpr(compiler, expr, false);
+    }
+}
+
+// Compiles a procedure call: the operator, then the arguments, then the call
+void compileCall(Compiler *compiler, SchemeItem *expr, bool tail) {
+    int count = 0;
+    while (typeOf(expr) == CONS_TYPE) {
+        compileExpr(compiler, expr->car, false);
+        count++;
+        expr = expr->cdr;
+    }
+    emitOp(compiler, tail ? OP_TAIL_CALL : OP_CALL, 1 - count);
+    emit(compiler, count - 1);
+}
+
+// Compiles a special form or a call
+void compileList(Compiler *compiler, SchemeItem *expr, bool tail) {
+    SchemeItem *first = expr->car;
+    SchemeItem *args = expr->cdr;
+    if (typeOf(first) != SYMBOL_TYPE || first->form == NOT_SPECIAL) {
+        compileCall(compiler, expr, tail);
+        return;
+    }
+
+    switch (first->form) {
+        case QUOTE_FORM:
+            emitConstant(compiler, args->car);
+            emitReturn(compiler, tail);
+            break;
+        case IF_FORM: {
+            compileExpr(compiler, args->car, false);
+            int otherwise = emitJump(compiler, OP_JUMP_IF_FALSE, -1);
+            int depth = compiler->depth;
+            compileExpr(compiler, args->cdr->car, tail);
+            int end = -1;
+            if (!tail) {
+                end = emitJump(compiler, OP_JUMP, 0);
+            }
+            patchJump(compiler, otherwise);
+            compiler->depth = depth;
+            compileExpr(compiler, args->cdr->cdr->car, tail);
+            if (!tail) {
+                patchJump(compiler, end);
+            }
+            break;
+        }
+        case DEFINE_FORM:
+        case SET_FORM: {
+            SchemeItem *reference = args->car;
+            if (first->form == DEFINE_FORM) {
+                compileBinding(compiler, args->cdr->car, reference->symbol);
+            } else {
+                compileExpr(compiler, args->cdr->car, false);
+            }
+            int name = addConstant(compiler, reference->symbol);
+            if (typeOf(reference) == GLOBAL_TYPE && first->form == DEFINE_FORM) {
+                emitOp(compiler, OP_DEFINE_GLOBAL, 0);
+                emit(compiler, name);
+            } else if (typeOf(reference) == GLOBAL_TYPE) {
+                emitOp(compiler, OP_SET_GLOBAL, 0);
+                emit(compiler, name);
+                emit(compiler, addConstant(compiler, NULL));
+            } else if (first->form == DEFINE_FORM) {
+                emitOp(compiler, OP_DEFINE_LOCAL, 0);
+                emit(compiler, reference->index);
+            } else {
+                emitOp(compiler, typeOf(reference) == BOXED_TYPE ? OP_SET_BOXED : OP_SET_LOCAL, 0);
+                emit(compiler, reference->depth);
+                emit(compiler, reference->index);
+                emit(compiler, name);
+            }
+            emitReturn(compiler, tail);
+            break;
+        }
+        case BEGIN_FORM:
+            if (typeOf(args) != CONS_TYPE) {
+                emitConstant(compiler, SCHEME_VOID);
+                emitReturn(compiler, tail);
+            } else {
+                compileBody(compiler, args, tail);
+            }
+            break;
+        case LET_FORM:
+            compileLet(compiler, args, tail, false);
+            break;
+        case LETREC_FORM:
+            compileLet(compiler, args, tail, true);
+            break;
+        case COND_FORM:
+            compileCond(compiler, args, tail);
+            break;
+        case AND_FORM:
+            compileAndOr(compiler, args, tail, true);
+            break;
+        case OR_FORM:
+            compileAndOr(compiler, args, tail, false);
+            break;
+        default:
+            printf("Evaluation error\n");
+            texit(1);
+    }
+}
+
+// Compiles any analyzed expression. An expression in tail position leaves the
+// code, by returning its value or by a tail call.
+void compileExpr(Compiler *compiler, SchemeItem *expr, bool tail) {
+    switch (typeOf(expr)) {
+        case INT_TYPE:
+        case BIGNUM_TYPE:
+        case VECTOR_TYPE:
+        case DOUBLE_TYPE:
+        case STR_TYPE:
+        case BOOL_TYPE:
+            emitConstant(compiler, expr);
+            emitReturn(compiler, tail);
+            break;
+        case LOCAL_TYPE:
+            emitSlot(compiler, expr);
+            emitReturn(compiler, tail);
+            break;
+        case BOXED_TYPE:
+            emitOp(compiler, OP_BOXED, 1);
+            emit(compiler, expr->depth);
+            emit(compiler, expr->index);
+            emit(compiler, addConstant(compiler, expr->symbol));
+            emitReturn(compiler, tail);
+            break;
+        case GLOBAL_TYPE:
+            emitOp(compiler, OP_GLOBAL, 1);
+            emit(compiler, addConstant(compiler, expr->symbol));
+            emit(compiler, addConstant(compiler, NULL));
+            emitReturn(compiler, tail);
+            break;
+        case LAMBDA_TYPE:
+            compileClosure(compiler, expr, NULL);
+            emitReturn(compiler, tail);
+            break;
+        case FOLDED_TYPE: {
+            // the folded value, or if that has gone stale, the call it came from
+            emitOp(compiler, OP_FOLDED, 0);
+            emit(compiler, addConstant(compiler, expr->folded));
+            emit(compiler, (int)expr->redefinitions);
+            int end = compiler->count;
+            emit(compiler, 0);
+            compileExpr(compiler, expr->original, false);
+            patchJump(compiler, end);
+            emitReturn(compiler, tail);
+            break;
+        }
+        case CONS_TYPE:
+            compileList(compiler, expr, tail);
+            break;
+        default:
+            printf("Evaluation error: SchemeItem doesn't have a type\n");
+            texit(1);
+    }
+}
+
+// Starts compiling a new Code
+void startCode(Compiler *compiler) {
+    compiler->code = gcAllocOldNoCollect(GC_CODE, sizeof(Code));
+}
+
+// Copies the compiler's instructions into its Code
+Code *finishCode(Compiler *compiler) {
+    int *instructions = gcAllocOldNoCollect(GC_RAW, compiler->count * sizeof(int));
+    memcpy(instructions, compiler->instructions, compiler->count * sizeof(int));
+    free(compiler->instructions);
+
+    Code *code = compiler->code;
+    code->instructions = instructions;
+    code->maxStack = compiler->max_depth;
+    return code;
+}
+
+// Compiles the body of a lambda, which runs in the frame made for each call
+Code *compileLambda(SchemeItem *lambda) {
+    Compiler compiler = {0};
+    startCode(&compiler);
+    compileBody(&compiler, lambda->body, true);
+
+    Code *code = finishCode(&compiler);
+    code->paramCount = lambda->paramCount;
+    code->frameSize = lambda->frameSize;
+    code->rest = lambda->rest;
+    return code;
+}
+
+// Compiles a top-level form (see compiler.h)
+Code *compile(SchemeItem *tree) {
+    Compiler compiler = {0};
+    startCode(&compiler);
+    compileExpr(&compiler, tree, true);
+    return finishCode(&compiler);
+}
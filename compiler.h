@@ -0,0 +1,14 @@
+#include "schemeitem.h"
+#include "vm.h"
+
+#ifndef _COMPILER
+#define _COMPILER
+
+// Compiles one analyzed top-level form (see analyzer.h) to bytecode for the VM.
+// Every lambda in it becomes its own Code, referred to from a CODE_TYPE
+// constant. Literals and quoted data are constants as they are. Never collects,
+// but the code isn't rooted either: the caller has to run it (or root it) before
+// allocating anything.
+Code *compile(SchemeItem *tree);
+
+#endif
@@ -0,0 +1,617 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "talloc.h"
+#include "gc.h"
+#include "vm.h"
+#include "stats.h"
+
+// Every object the collector knows about is preceded by this header. Permanent
+// objects have one too, so the collector can tell them apart from heap objects
+// without a lookup.
+typedef struct GCHeader {
+    uint32_t size; // payload size in bytes
+    uint8_t kind;  // a gcKind
+    uint8_t flags;
+    uint16_t unused;
+} GCHeader;
+
+#define GC_MARKED 1
+#define GC_PERMANENT 2
+#define GC_FORWARDED 4  // a nursery object that has been promoted; its first word is the new address
+#define GC_REMEMBERED 8 // an old object already sitting in the remembered set
+
+#define HEADER(pointer) ((GCHeader *)((char *)(pointer) - sizeof(GCHeader)))
+#define PAYLOAD(header) ((void *)((char *)(header) + sizeof(GCHeader)))
+
+// Small objects live in pages of equally sized cells, one size class per 8
+// bytes of cell size. Anything bigger than MAX_CELL gets its own malloc.
+#define PAGE_SIZE (64 * 1024)
+#define MAX_CELL 512
+#define CLASSES (MAX_CELL / 8 + 1)
+
+typedef struct Page {
+    struct Page *next;
+    size_t cell_size;
+    size_t cell_count;
+    size_t unused;
+} Page;
+
+typedef struct LargeObject {
+    struct LargeObject *next;
+    GCHeader header;
+} LargeObject;
+
+// New small objects are bumped out of the nursery. When it fills up, a minor
+// collection copies whatever is still reachable into the pages below (the old
+// generation) and the nursery starts over from the bottom.
+char *nursery_start = NULL;
+char *nursery_top = NULL;
+char *nursery_end = NULL;
+size_t nursery_size = 256 * 1024;
+
+#define IN_NURSERY(pointer) ((char *)(pointer) >= nursery_start && (char *)(pointer) < nursery_end)
+
+Page *pages[CLASSES];
+GCHeader *free_cells[CLASSES]; // free cells are chained through their first payload word
+LargeObject *large_objects = NULL;
+
+size_t heap_bytes = 0;   // bytes in old generation objects that have not been swept
+size_t peak_heap_bytes = 0;
+size_t threshold = 8 * 1024 * 1024;
+size_t initial_threshold = 8 * 1024 * 1024;
+double growth_factor = 2.0;
+bool stress_collect = false;
+size_t collections = 0;
+size_t minor_collections = 0;
+size_t promoted_bytes = 0;
+size_t allocations = 0;
+size_t allocated_bytes = 0;
+
+void ***root_stack = NULL;
+size_t root_count = 0;
+size_t root_capacity = 0;
+
+// Arrays registered with gcAddRootArray
+#define MAX_ROOT_ARRAYS 8
+void **root_arrays[MAX_ROOT_ARRAYS];
+size_t *root_array_counts[MAX_ROOT_ARRAYS];
+size_t root_array_count = 0;
+
+void **mark_stack = NULL; // also the queue of promoted objects during a minor collection
+size_t mark_count = 0;
+size_t mark_capacity = 0;
+
+// Old objects that may point into the nursery, so must be scanned by the next minor collection
+void **remembered = NULL;
+size_t remembered_count = 0;
+size_t remembered_capacity = 0;
+
+// Sets the heap growth policy (see gc.h)
+void gcConfigure(size_t initial, double growth, size_t nursery, bool stress) {
+    initial_threshold = initial;
+    threshold = initial;
+    growth_factor = growth < 1.0 ? 1.0 : growth;
+    nursery_size = nursery < 4096 ? 4096 : nursery;
+    stress_collect = stress;
+}
+
+// Grows a malloc'ed array of pointers so it can hold at least one more entry
+void *growArray(void *array, size_t *capacity, size_t element_size) {
+    *capacity = *capacity == 0 ? 1024 : *capacity * 2;
+    void *grown = realloc(array, *capacity * element_size);
+    if (grown == NULL) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    return grown;
+}
+
+// Registers the address of a local pointer as a root
+void gcPushRoot(void **slot) {
+    if (root_count == root_capacity) {
+        root_stack = growArray(root_stack, &root_capacity, sizeof(void **));
+    }
+    root_stack[root_count++] = slot;
+}
+
+// Registers the first *count entries of array as roots
+void gcAddRootArray(void **array, size_t *count) {
+    if (root_array_count == MAX_ROOT_ARRAYS) {
+        printf("Error: too many root arrays\n");
+        exit(1);
+    }
+    root_arrays[root_array_count] = array;
+    root_array_counts[root_array_count] = count;
+    root_array_count++;
+}
+
+// Returns the current height of the shadow stack, to be handed back to gcRestoreRoots
+size_t gcSaveRoots() {
+    return root_count;
+}
+
+// Pops every root pushed since the matching gcSaveRoots
+void gcRestoreRoots(size_t mark) {
+    root_count = mark;
+}
+
+// Carves a new page for the given size class and threads its cells onto the free list
+void addPage(size_t size_class) {
+    Page *page = malloc(PAGE_SIZE);
+    if (page == NULL) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    page->cell_size = size_class * 8;
+    page->cell_count = (PAGE_SIZE - sizeof(Page)) / page->cell_size;
+    page->next = pages[size_class];
+    pages[size_class] = page;
+
+    char *cells = (char *)page + sizeof(Page);
+    for (size_t i = 0; i < page->cell_count; i++) {
+        GCHeader *cell = (GCHeader *)(cells + i * page->cell_size);
+        cell->size = page->cell_size - sizeof(GCHeader);
+        cell->kind = GC_FREE;
+        cell->flags = 0;
+        *(GCHeader **)PAYLOAD(cell) = free_cells[size_class];
+        free_cells[size_class] = cell;
+    }
+}
+
+// Allocates an uninitialized object in the old generation. Never collects.
+GCHeader *allocOld(size_t payload) {
+    size_t cell_size = payload + sizeof(GCHeader);
+    heap_bytes = heap_bytes + cell_size;
+    if (heap_bytes > peak_heap_bytes) {
+        peak_heap_bytes = heap_bytes;
+    }
+
+    GCHeader *header;
+    if (cell_size > MAX_CELL) {
+        LargeObject *large = malloc(sizeof(LargeObject) + payload);
+        if (large == NULL) {
+            printf("Error: out of memory\n");
+            exit(1);
+        }
+        large->next = large_objects;
+        large_objects = large;
+        header = &large->header;
+    } else {
+        size_t size_class = cell_size / 8;
+        if (free_cells[size_class] == NULL) {
+            addPage(size_class);
+        }
+        header = free_cells[size_class];
+        free_cells[size_class] = *(GCHeader **)PAYLOAD(header);
+    }
+    header->size = payload;
+    return header;
+}
+
+// Adds an old object to the remembered set
+void remember(GCHeader *header) {
+    header->flags = header->flags | GC_REMEMBERED;
+    if (remembered_count == remembered_capacity) {
+        remembered = growArray(remembered, &remembered_capacity, sizeof(void *));
+    }
+    remembered[remembered_count++] = PAYLOAD(header);
+}
+
+// Allocates an object in the old generation that starts out remembered: it was
+// never young, so whatever gets stored in it has to be found by the next minor
+// collection. Never collects.
+GCHeader *allocRemembered(gcKind kind, size_t payload) {
+    GCHeader *header = allocOld(payload);
+    header->flags = 0;
+    if (kind != GC_RAW) {
+        remember(header);
+    }
+    return header;
+}
+
+// Allocates an object in the old generation for gcAlloc, running a full
+// collection first if the old generation has outgrown its threshold
+GCHeader *allocTenured(gcKind kind, size_t payload) {
+    if (heap_bytes + payload + sizeof(GCHeader) > threshold) {
+        gcCollect();
+    }
+    return allocRemembered(kind, payload);
+}
+
+// Allocates a zeroed object. Small objects are bumped out of the nursery, running a
+// minor collection when it is full; big ones go straight to the old generation.
+void *gcAlloc(gcKind kind, size_t size) {
+    STAT(statsAlloc(size));
+    size_t payload = size < 8 ? 8 : (size + 7) & ~(size_t)7;
+    size_t cell_size = payload + sizeof(GCHeader);
+    allocations++;
+    allocated_bytes = allocated_bytes + cell_size;
+
+    if (nursery_start == NULL) {
+        nursery_start = malloc(nursery_size);
+        if (nursery_start == NULL) {
+            printf("Error: out of memory\n");
+            exit(1);
+        }
+        nursery_top = nursery_start;
+        nursery_end = nursery_start + nursery_size;
+    }
+    if (stress_collect) {
+        gcCollect();
+    }
+
+    GCHeader *header;
+    if (cell_size > MAX_CELL) {
+        header = allocTenured(kind, payload);
+    } else {
+        if (nursery_top + cell_size > nursery_end) {
+            gcMinorCollect();
+            if (heap_bytes > threshold) {
+                gcCollect();
+            }
+        }
+        header = (GCHeader *)nursery_top;
+        nursery_top = nursery_top + cell_size;
+        header->size = payload;
+        header->flags = 0;
+    }
+
+    header->kind = kind;
+    memset(PAYLOAD(header), 0, payload);
+    return PAYLOAD(header);
+}
+
+// Allocates a zeroed object that never moves (see gc.h)
+void *gcAllocOld(gcKind kind, size_t size) {
+    STAT(statsAlloc(size));
+    size_t payload = size < 8 ? 8 : (size + 7) & ~(size_t)7;
+    allocations++;
+    allocated_bytes = allocated_bytes + payload + sizeof(GCHeader);
+    if (stress_collect) {
+        gcCollect();
+    }
+
+    GCHeader *header = allocTenured(kind, payload);
+    header->kind = kind;
+    memset(PAYLOAD(header), 0, payload);
+    return PAYLOAD(header);
+}
+
+// Allocates a zeroed object that never moves, without collecting (see gc.h)
+void *gcAllocOldNoCollect(gcKind kind, size_t size) {
+    STAT(statsAlloc(size));
+    size_t payload = size < 8 ? 8 : (size + 7) & ~(size_t)7;
+    allocations++;
+    allocated_bytes = allocated_bytes + payload + sizeof(GCHeader);
+
+    GCHeader *header = allocRemembered(kind, payload);
+    header->kind = kind;
+    memset(PAYLOAD(header), 0, payload);
+    return PAYLOAD(header);
+}
+
+// Records that a pointer was just stored into object. Old objects that might now
+// point into the nursery are remembered, so a minor collection can find those
+// pointers without scanning the whole old generation.
+void gcWriteBarrier(void *object) {
+    if (IN_NURSERY(object)) {
+        return;
+    }
+    GCHeader *header = HEADER(object);
+    if ((header->flags & (GC_REMEMBERED | GC_PERMANENT)) == 0) {
+        remember(header);
+    }
+}
+
+// Returns whether the next minor collection will move object (see gc.h)
+bool gcIsYoung(void *object) {
+    return IN_NURSERY(object);
+}
+
+// Allocates an object out of the talloc arena, where the collector never touches it
+void *gcAllocPermanent(gcKind kind, size_t size) {
+    size_t payload = size < 8 ? 8 : (size + 7) & ~(size_t)7;
+    GCHeader *header = talloc(sizeof(GCHeader) + payload);
+    header->size = payload;
+    header->kind = kind;
+    header->flags = GC_PERMANENT;
+    memset(PAYLOAD(header), 0, payload);
+    return PAYLOAD(header);
+}
+
+// Pushes an object onto the mark stack
+void pushMark(void *pointer) {
+    if (mark_count == mark_capacity) {
+        mark_stack = growArray(mark_stack, &mark_capacity, sizeof(void *));
+    }
+    mark_stack[mark_count++] = pointer;
+}
+
+// Marks a single object and pushes it so its fields get traced
+void *markObject(void *pointer) {
+    if (pointer == NULL || isImmediate(pointer)) {
+        return pointer;
+    }
+    GCHeader *header = HEADER(pointer);
+    if (header->flags & (GC_MARKED | GC_PERMANENT)) {
+        return pointer;
+    }
+    header->flags = header->flags | GC_MARKED;
+    pushMark(pointer);
+    return pointer;
+}
+
+// Copies a nursery object into the old generation (once), leaving a forwarding
+// address behind, and returns where it lives now. Anything outside the nursery
+// (and any immediate, which only looks like a pointer) is returned unchanged.
+void *promoteObject(void *pointer) {
+    if (pointer == NULL || isImmediate(pointer) || !IN_NURSERY(pointer)) {
+        return pointer;
+    }
+    GCHeader *header = HEADER(pointer);
+    if (header->flags & GC_FORWARDED) {
+        return *(void **)pointer;
+    }
+
+    GCHeader *copy = allocOld(header->size);
+    copy->kind = header->kind;
+    copy->flags = 0;
+    memcpy(PAYLOAD(copy), pointer, header->size);
+    promoted_bytes = promoted_bytes + header->size + sizeof(GCHeader);
+
+    header->flags = GC_FORWARDED;
+    *(void **)pointer = PAYLOAD(copy);
+
+    pushMark(PAYLOAD(copy)); // its fields still point into the nursery
+    return PAYLOAD(copy);
+}
+
+// Runs visit on every pointer held by an object, storing back what it returns
+void traceObject(void *pointer, void *(*visit)(void *)) {
+    switch (HEADER(pointer)->kind) {
+        case GC_ITEM: {
+            SchemeItem *item = pointer;
+            if (item->type == CONS_TYPE) {
+                item->car = visit(item->car);
+                item->cdr = visit(item->cdr);
+            } else if (item->type == CLOSURE_TYPE) {
+                item->lambda = visit(item->lambda);
+                item->frame = visit(item->frame);
+            } else if (item->type == GLOBAL_TYPE) {
+                item->binding = visit(item->binding);
+            } else if (item->type == LAMBDA_TYPE) {
+                item->body = visit(item->body);
+                item->captures = visit(item->captures);
+            } else if (item->type == FOLDED_TYPE) {
+                item->folded = visit(item->folded);
+                item->original = visit(item->original);
+            } else if (item->type == BOX_TYPE) {
+                item->contents = visit(item->contents);
+            } else if (item->type == STR_TYPE) {
+                item->text = visit(item->text);
+            } else if (item->type == HASHTABLE_TYPE) {
+                item->entries = visit(item->entries);
+            } else if (item->type == CODE_TYPE) {
+                item->ptr = visit(item->ptr);
+            } else if (item->type == VECTOR_TYPE) {
+                Vector *vector = pointer;
+                for (long i = 0; i < vector->length; i++) {
+                    vector->items[i] = visit(vector->items[i]);
+                }
+            }
+            break;
+        }
+        case GC_FRAME: {
+            Frame *frame = pointer;
+            frame->parent = visit(frame->parent);
+            for (int i = 0; i < frame->size; i++) {
+                frame->slots[i] = visit(frame->slots[i]);
+            }
+            break;
+        }
+        case GC_CODE: {
+            Code *code = pointer;
+            code->instructions = visit(code->instructions);
+            code->constants = visit(code->constants);
+            for (int i = 0; i < code->constantCount; i++) {
+                code->constants[i] = visit(code->constants[i]);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Empties the nursery by promoting everything reachable from the roots and the
+// remembered set. Its cost depends only on how much of the nursery is live.
+void gcMinorCollect() {
+    minor_collections++;
+
+    for (size_t i = 0; i < root_count; i++) {
+        *root_stack[i] = promoteObject(*root_stack[i]);
+    }
+    for (size_t i = 0; i < root_array_count; i++) {
+        for (size_t j = 0; j < *root_array_counts[i]; j++) {
+            root_arrays[i][j] = promoteObject(root_arrays[i][j]);
+        }
+    }
+    for (size_t i = 0; i < remembered_count; i++) {
+        HEADER(remembered[i])->flags = HEADER(remembered[i])->flags & ~GC_REMEMBERED;
+        traceObject(remembered[i], promoteObject);
+    }
+    remembered_count = 0;
+
+    while (mark_count > 0) {
+        traceObject(mark_stack[--mark_count], promoteObject);
+    }
+
+    if (stress_collect) {
+        memset(nursery_start, 0xdb, nursery_top - nursery_start);
+    }
+    nursery_top = nursery_start;
+}
+
+// Returns a cell to its size class. Under the stress collector the payload is
+// scribbled over first, so that anything still using it fails loudly.
+void freeCell(GCHeader *cell, size_t size_class) {
+    if (stress_collect) {
+        memset(PAYLOAD(cell), 0xdb, cell->size);
+    }
+    cell->kind = GC_FREE;
+    cell->flags = 0;
+    *(GCHeader **)PAYLOAD(cell) = free_cells[size_class];
+    free_cells[size_class] = cell;
+}
+
+// Sweeps every page and large object, rebuilding the free lists. Pages that
+// end up completely empty are handed back to malloc.
+void sweep() {
+    heap_bytes = 0;
+
+    for (size_t size_class = 0; size_class < CLASSES; size_class++) {
+        free_cells[size_class] = NULL;
+
+        Page **link = &pages[size_class];
+        while (*link != NULL) {
+            Page *page = *link;
+            char *cells = (char *)page + sizeof(Page);
+            GCHeader *page_free = free_cells[size_class];
+            size_t live = 0;
+
+            for (size_t i = 0; i < page->cell_count; i++) {
+                GCHeader *cell = (GCHeader *)(cells + i * page->cell_size);
+                if (cell->flags & GC_MARKED) {
+                    cell->flags = cell->flags & ~GC_MARKED;
+                    live++;
+                } else {
+                    freeCell(cell, size_class);
+                }
+            }
+
+            if (live == 0) {
+                free_cells[size_class] = page_free; // drop this page's cells again
+                *link = page->next;
+                free(page);
+            } else {
+                heap_bytes = heap_bytes + live * page->cell_size;
+                link = &page->next;
+            }
+        }
+    }
+
+    LargeObject **link = &large_objects;
+    while (*link != NULL) {
+        LargeObject *large = *link;
+        if (large->header.flags & GC_MARKED) {
+            large->header.flags = large->header.flags & ~GC_MARKED;
+            heap_bytes = heap_bytes + large->header.size + sizeof(GCHeader);
+            link = &large->next;
+        } else {
+            *link = large->next;
+            free(large);
+        }
+    }
+}
+
+// Empties the nursery, then marks the old generation from every root on the
+// shadow stack and sweeps whatever wasn't reached
+void gcCollect() {
+    gcMinorCollect();
+    collections++;
+
+    for (size_t i = 0; i < root_count; i++) {
+        markObject(*root_stack[i]);
+    }
+    for (size_t i = 0; i < root_array_count; i++) {
+        for (size_t j = 0; j < *root_array_counts[i]; j++) {
+            markObject(root_arrays[i][j]);
+        }
+    }
+    while (mark_count > 0) {
+        traceObject(mark_stack[--mark_count], markObject);
+    }
+
+    sweep();
+
+    size_t next = (size_t)(heap_bytes * growth_factor);
+    threshold = next > initial_threshold ? next : initial_threshold;
+}
+
+// Returns the number of bytes in old generation objects that have not been swept
+size_t gcHeapBytes() {
+    return heap_bytes;
+}
+
+// Returns the number of full collections run so far
+size_t gcCollections() {
+    return collections;
+}
+
+// Returns the number of minor (nursery) collections run so far
+size_t gcMinorCollections() {
+    return minor_collections;
+}
+
+// Returns the number of bytes copied out of the nursery so far
+size_t gcPromotedBytes() {
+    return promoted_bytes;
+}
+
+// Returns the number of objects allocated so far, and their bytes (headers included)
+size_t gcAllocations() {
+    return allocations;
+}
+
+size_t gcAllocatedBytes() {
+    return allocated_bytes;
+}
+
+// Returns the most bytes the old generation has held at once
+size_t gcPeakHeapBytes() {
+    return peak_heap_bytes;
+}
+
+// Frees all heap pages, large objects and the collector's own stacks
+void gcFreeHeap() {
+    for (size_t size_class = 0; size_class < CLASSES; size_class++) {
+        while (pages[size_class] != NULL) {
+            Page *next = pages[size_class]->next;
+            free(pages[size_class]);
+            pages[size_class] = next;
+        }
+        free_cells[size_class] = NULL;
+    }
+    while (large_objects != NULL) {
+        LargeObject *next = large_objects->next;
+        free(large_objects);
+        large_objects = next;
+    }
+
+    free(root_stack);
+    root_stack = NULL;
+    root_count = 0;
+    root_capacity = 0;
+    root_array_count = 0;
+
+    free(mark_stack);
+    mark_stack = NULL;
+    mark_count = 0;
+    mark_capacity = 0;
+
+    free(remembered);
+    remembered = NULL;
+    remembered_count = 0;
+    remembered_capacity = 0;
+
+    free(nursery_start);
+    nursery_start = NULL;
+    nursery_top = NULL;
+    nursery_end = NULL;
+
+    heap_bytes = 0;
+}
@@ -0,0 +1,98 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _GC
+#define _GC
+
+// What an object allocated by the collector holds. This tells the collector
+// which fields (if any) are pointers it has to follow.
+typedef enum {
+    GC_ITEM,  // a SchemeItem (or a Vector)
+    GC_FRAME, // a Frame
+    GC_RAW,   // plain bytes with no pointers in them
+    GC_CODE,  // compiled code (see Code in vm.h)
+    GC_FREE   // a free cell (only ever seen by the collector itself)
+} gcKind;
+
+// Sets the heap policy. New objects are allocated in a nursery of the given
+// size; when it fills up, the survivors are copied into the old generation. A
+// full collection happens whenever the old generation holds more than the
+// threshold number of bytes. After each one the threshold becomes growth times
+// the bytes that survived, but never less than initial. A stress collector
+// runs a full collection before every single allocation, which is only useful
+// for shaking out missing roots and write barriers.
+void gcConfigure(size_t initial, double growth, size_t nursery, bool stress);
+
+// Allocates a zeroed object of the given kind from the collected heap. May run
+// a collection first, which can move objects, so every live pointer the caller
+// holds must be rooted (and read back out of its root afterwards).
+void *gcAlloc(gcKind kind, size_t size);
+
+// Allocates a zeroed object straight into the old generation, so it never moves.
+// It is collected like any other object once nothing points to it. For objects
+// whose address is kept somewhere the collector doesn't update (the global
+// bindings cached in code).
+void *gcAllocOld(gcKind kind, size_t size);
+
+// Like gcAllocOld, but never runs a collection, so every pointer the caller
+// holds stays good without being rooted. For the compiler, which walks the
+// analyzed tree as it allocates code; the next allocation that can collect
+// catches up on the threshold.
+void *gcAllocOldNoCollect(gcKind kind, size_t size);
+
+// Allocates an object that is never collected or moved (symbols, primitives).
+// Permanent objects must not point into the collected heap.
+void *gcAllocPermanent(gcKind kind, size_t size);
+
+// Returns whether object is in the nursery, where the next minor collection will
+// move it. Nothing else ever moves: old and permanent objects keep their address.
+bool gcIsYoung(void *object);
+
+// Runs a full mark-and-sweep collection (after emptying the nursery).
+void gcCollect();
+
+// Empties the nursery into the old generation.
+void gcMinorCollect();
+
+// Write barrier. Must be called after storing a SchemeItem or Frame pointer
+// into an object that was not allocated since the last call that could have
+// collected, e.g. gcWriteBarrier(pair) after pair->cdr = value.
+void gcWriteBarrier(void *object);
+
+// The shadow stack. Any function that keeps a SchemeItem or Frame pointer in a
+// local across a call that might allocate registers the address of that local
+// with GC_ROOT, and pops its roots again before returning:
+//
+//     size_t roots = gcSaveRoots();
+//     GC_ROOT(list);
+//     ...
+//     gcRestoreRoots(roots);
+void gcPushRoot(void **slot);
+size_t gcSaveRoots();
+void gcRestoreRoots(size_t mark);
+
+#define GC_ROOT(var) gcPushRoot((void **)&(var))
+
+// Registers a whole array of pointers as roots, such as the VM's value stack.
+// Only the first *count entries are roots, and count is read again at every
+// collection, so the array can be pushed and popped freely in between.
+void gcAddRootArray(void **array, size_t *count);
+
+// Bytes currently held by the old generation, the number of full and minor
+// collections so far, and the bytes copied out of the nursery.
+size_t gcHeapBytes();
+size_t gcCollections();
+size_t gcMinorCollections();
+size_t gcPromotedBytes();
+
+// Objects (and bytes, headers included) allocated from the heap so far, and the
+// most bytes the old generation has held at once.
+size_t gcAllocations();
+size_t gcAllocatedBytes();
+size_t gcPeakHeapBytes();
+
+// Releases every page of the heap. Called from tfree.
+void gcFreeHeap();
+
+#endif
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "gc.h"
+#include "number.h"
+#include "schemestring.h"
+#include "hashtable.h"
+
+// Slots in a new table. Capacities are always powers of two.
+#define INITIAL_CAPACITY 8
+
+// How many elements of a list or vector key are hashed, so a long list (or a
+// cycle) costs no more to hash than a short one
+#define HASH_BUDGET 16
+
+// The key of a deleted entry. It keeps probes for the keys after it going, and is
+// taken over by the next key added there.
+SchemeItem *deleted_key = NULL;
+
+// Returns whether two items are equal? (see hashtable.h). Lists are walked along
+// their cdrs in a loop, so a long one doesn't recurse deeply.
+bool isEqual(SchemeItem *left, SchemeItem *right) {
+    while (left != right) {
+        if (typeOf(left) != typeOf(right)) {
+            return false;
+        }
+        switch (typeOf(left)) {
+            case BIGNUM_TYPE:
+                return numberCompare(left, right) == 0;
+            case DOUBLE_TYPE:
+                return left->d == right->d;
+            case STR_TYPE:
+                return stringEqual(left, right);
+            case VECTOR_TYPE: {
+                Vector *first = (Vector *)left;
+                Vector *second = (Vector *)right;
+                if (first->length != second->length) {
+                    return false;
+                }
+                for (long i = 0; i < first->length; i++) {
+                    if (!isEqual(first->items[i], second->items[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case CONS_TYPE:
+                if (!isEqual(left->car, right->car)) {
+                    return false;
+                }
+                left = left->cdr;
+                right = right->cdr;
+                break;
+            default:
+                // fixnums, symbols and the other immediates are only equal when
+                // they are the same pointer
+                return false;
+        }
+    }
+    return true;
+}
+
+// Scrambles the bits of a hash (the MurmurHash3 finalizer), so that keys which
+// only differ in their high bits, or addresses that are all multiples of 16,
+// still spread out over the low bits that pick a slot
+uint64_t mixHash(uint64_t hash) {
+    hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+    hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 33);
+}
+
+// Hashes an item by its structure, so that equal? items hash the same. budget is
+// how many more list and vector elements may be looked at.
+uint64_t hashStructure(SchemeItem *key, int *budget) {
+    switch (typeOf(key)) {
+        case INT_TYPE:
+        case BIGNUM_TYPE:
+            return integerHash(key);
+        case DOUBLE_TYPE: {
+            double value = key->d == 0 ? 0.0 : key->d; // -0.0 is equal? to 0.0
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+        case STR_TYPE:
+            return stringHash(key);
+        case CONS_TYPE: {
+            uint64_t hash = CONS_TYPE;
+            while (typeOf(key) == CONS_TYPE && *budget > 0) {
+                *budget = *budget - 1;
+                hash = mixHash(hash ^ hashStructure(key->car, budget));
+                key = key->cdr;
+            }
+            if (typeOf(key) != CONS_TYPE) {
+                hash = mixHash(hash ^ hashStructure(key, budget));
+            }
+            return hash;
+        }
+        case VECTOR_TYPE: {
+            Vector *vector = (Vector *)key;
+            uint64_t hash = mixHash(VECTOR_TYPE ^ (uint64_t)vector->length);
+            for (long i = 0; i < vector->length && *budget > 0; i++) {
+                *budget = *budget - 1;
+                hash = mixHash(hash ^ hashStructure(vector->items[i], budget));
+            }
+            return hash;
+        }
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+        case EMPTY_TYPE:
+        case VOID_TYPE:
+        case UNSPECIFIED_TYPE:
+            // immediates and symbols (which are permanent) never move
+            return (uintptr_t)key;
+        default:
+            // anything else is only equal to itself, but can move, so its address
+            // can't be hashed
+            return typeOf(key);
+    }
+}
+
+// Returns the hash of key in table: its address, or its structure
+uint64_t hashKey(SchemeItem *table, SchemeItem *key) {
+    if (!table->equal) {
+        return mixHash((uintptr_t)key);
+    }
+    int budget = HASH_BUDGET;
+    return mixHash(hashStructure(key, &budget));
+}
+
+// Returns whether an entry's key is key, as the table compares them
+bool sameKey(SchemeItem *table, SchemeItem *entry_key, SchemeItem *key) {
+    return table->equal ? isEqual(entry_key, key) : entry_key == key;
+}
+
+// Notes a key just stored in an eq? table that is still in the nursery, so the
+// table gets rehashed once the key has moved
+void noteKey(SchemeItem *table, SchemeItem *key) {
+    if (!table->equal && !isImmediate(key) && gcIsYoung(key)) {
+        table->young_keys = true;
+        table->epoch = (uint32_t)gcMinorCollections();
+    }
+}
+
+// Returns the slot holding key, or -1 if it isn't in the table. Never allocates.
+long findEntry(SchemeItem *table, SchemeItem *key) {
+    Vector *entries = (Vector *)table->entries;
+    long mask = entries->length / 2 - 1;
+    long slot = hashKey(table, key) & mask;
+    while (entries->items[2 * slot] != NULL) {
+        SchemeItem *entry_key = entries->items[2 * slot];
+        if (entry_key != deleted_key && sameKey(table, entry_key, key)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// Moves every entry into a new vector with room for capacity of them, leaving
+// the deleted entries behind. The keys are hashed after the vector is allocated,
+// so they are hashed where they are now.
+void resizeTable(SchemeItem *table, long capacity) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(table);
+    SchemeItem *new_entries = makeVector(2 * capacity, NULL);
+    gcRestoreRoots(roots);
+
+    Vector *old = (Vector *)table->entries;
+    Vector *entries = (Vector *)new_entries;
+    table->entries = new_entries;
+    gcWriteBarrier(table);
+    table->used = table->count;
+    table->young_keys = false;
+
+    long mask = capacity - 1;
+    for (long i = 0; i < old->length; i = i + 2) {
+        SchemeItem *key = old->items[i];
+        if (key == NULL || key == deleted_key) {
+            continue;
+        }
+        long slot = hashKey(table, key) & mask;
+        while (entries->items[2 * slot] != NULL) {
+            slot = (slot + 1) & mask;
+        }
+        entries->items[2 * slot] = key;
+        entries->items[2 * slot + 1] = old->items[i + 1];
+        noteKey(table, key);
+    }
+}
+
+// Rehashes an eq? table whose young keys have been moved since they were hashed
+void refreshTable(SchemeItem *table) {
+    if (table->young_keys && table->epoch != (uint32_t)gcMinorCollections()) {
+        resizeTable(table, ((Vector *)table->entries)->length / 2);
+    }
+}
+
+// Makes an empty table (see hashtable.h)
+SchemeItem *makeHashTable(bool equal) {
+    if (deleted_key == NULL) {
+        deleted_key = gcAllocPermanent(GC_ITEM, sizeof(SchemeItem));
+        deleted_key->type = VOID_TYPE;
+    }
+
+    SchemeItem *entries = makeVector(2 * INITIAL_CAPACITY, NULL);
+    size_t roots = gcSaveRoots();
+    GC_ROOT(entries);
+    SchemeItem *table = makeItem(HASHTABLE_TYPE);
+    gcRestoreRoots(roots);
+
+    table->entries = entries;
+    table->equal = equal;
+    return table;
+}
+
+// Looks key up in the table (see hashtable.h)
+SchemeItem *hashTableRef(SchemeItem *table, SchemeItem *key) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(table);
+    GC_ROOT(key);
+    refreshTable(table);
+    gcRestoreRoots(roots);
+
+    long slot = findEntry(table, key);
+    return slot < 0 ? NULL : ((Vector *)table->entries)->items[2 * slot + 1];
+}
+
+// Sets the value of key (see hashtable.h). The table is resized first if adding
+// a key would fill it past three quarters: doubled, unless it is mostly deleted
+// entries, which the resize clears out.
+void hashTableSet(SchemeItem *table, SchemeItem *key, SchemeItem *value) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(table);
+    GC_ROOT(key);
+    GC_ROOT(value);
+
+    long capacity = ((Vector *)table->entries)->length / 2;
+    if ((table->used + 1) * 4 > capacity * 3) {
+        while ((table->count + 1) * 2 > capacity) {
+            capacity = capacity * 2;
+        }
+        resizeTable(table, capacity);
+    } else {
+        refreshTable(table);
+    }
+    gcRestoreRoots(roots);
+
+    Vector *entries = (Vector *)table->entries;
+    long mask = entries->length / 2 - 1;
+    long slot = hashKey(table, key) & mask;
+    long free_slot = -1;
+    while (entries->items[2 * slot] != NULL) {
+        SchemeItem *entry_key = entries->items[2 * slot];
+        if (entry_key == deleted_key) {
+            if (free_slot < 0) {
+                free_slot = slot;
+            }
+        } else if (sameKey(table, entry_key, key)) {
+            entries->items[2 * slot + 1] = value;
+            gcWriteBarrier(entries);
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (free_slot < 0) {
+        free_slot = slot;
+        table->used++;
+    }
+    entries->items[2 * free_slot] = key;
+    entries->items[2 * free_slot + 1] = value;
+    gcWriteBarrier(entries);
+    table->count++;
+    noteKey(table, key);
+}
+
+// Removes key from the table (see hashtable.h)
+bool hashTableDelete(SchemeItem *table, SchemeItem *key) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(table);
+    GC_ROOT(key);
+    refreshTable(table);
+    gcRestoreRoots(roots);
+
+    long slot = findEntry(table, key);
+    if (slot < 0) {
+        return false;
+    }
+    Vector *entries = (Vector *)table->entries;
+    entries->items[2 * slot] = deleted_key;
+    entries->items[2 * slot + 1] = NULL;
+    table->count--;
+    return true;
+}
+
+// Returns the number of keys in the table
+long hashTableCount(SchemeItem *table) {
+    return table->count;
+}
+
+// Lists the table's keys, values or entries (see hashtable.h). The entries are
+// looked up again after every cons, since it can move them.
+SchemeItem *hashTableList(SchemeItem *table, bool keys, bool values) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(table);
+
+    SchemeItem *list = makeEmpty();
+    GC_ROOT(list);
+    for (long i = 0; i < ((Vector *)table->entries)->length; i = i + 2) {
+        SchemeItem *key = ((Vector *)table->entries)->items[i];
+        if (key == NULL || key == deleted_key) {
+            continue;
+        }
+        SchemeItem *value = ((Vector *)table->entries)->items[i + 1];
+        SchemeItem *item = keys && values ? cons(key, value) : (keys ? key : value);
+        list = cons(item, list);
+    }
+
+    gcRestoreRoots(roots);
+    return list;
+}
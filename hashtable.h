@@ -0,0 +1,44 @@
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _HASHTABLE
+#define _HASHTABLE
+
+// Hash tables, with open addressing and linear probing. The keys and values sit
+// side by side in one vector, which doubles whenever it gets three quarters full
+// (counting deleted entries).
+//
+// An equal? table hashes keys by their structure, so it never depends on where
+// anything is. An eq? table hashes keys by address, which is fast, but the
+// collector moves young objects. The table notes when it holds a key that is
+// still in the nursery, and rehashes itself the first time it is used after the
+// next minor collection; by then every one of its keys is old, and stays put.
+//
+// Everything here except isEqual and hashTableCount can collect, so callers must
+// root anything else they hold.
+
+// Returns whether two items are equal?: numbers of the same exactness with the
+// same value, strings with the same text, and lists and vectors with equal
+// elements. Anything else is only equal to itself.
+bool isEqual(SchemeItem *left, SchemeItem *right);
+
+// Makes an empty table that compares keys with equal? (or with eq?)
+SchemeItem *makeHashTable(bool equal);
+
+// Returns the value of key, or NULL if it isn't in the table
+SchemeItem *hashTableRef(SchemeItem *table, SchemeItem *key);
+
+// Sets the value of key, adding it if it isn't in the table
+void hashTableSet(SchemeItem *table, SchemeItem *key, SchemeItem *value);
+
+// Removes key from the table. Returns whether it was there.
+bool hashTableDelete(SchemeItem *table, SchemeItem *key);
+
+// Returns the number of keys in the table
+long hashTableCount(SchemeItem *table);
+
+// Returns a new list of the table's keys, values, or (key . value) pairs if both
+// are true, in no particular order
+SchemeItem *hashTableList(SchemeItem *table, bool keys, bool values);
+
+#endif
@@ -6,299 +6,384 @@
 #include <stdbool.h>
 #include "parser.h"
 #include "talloc.h"
+#include "gc.h"
+#include "symbols.h"
+#include "analyzer.h"
+#include "compiler.h"
+#include "vm.h"
+#include "interpreter.h"
+#include "port.h"
+#include "number.h"
+#include "hashtable.h"
+#include "schemestring.h"
+#include "stats.h"
+#include "profile.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 // Included this decleration because evalIf was having trouble with calling eval, but eval has to call evalIf
 SchemeItem *eval(SchemeItem *tree, Frame *frame);
 
+// The top level bindings: an eq? hash table from each global's symbol to its
+// (symbol . value) pair. Local variables live in frame slots, but globals can be
+// defined at any point, so they are looked up by name. Symbols never move, so the
+// table never has to rehash.
+// Each pair is the global's cell: it is never replaced (set! changes its cdr) and
+// never moves, so a reference that has found it once keeps it (see globalBinding).
+SchemeItem *global_bindings = NULL;
+
+// How many times set! has changed a global that held a primitive. The analyzer
+// folds calls of primitives on constants into their values (see analyzer.h), and
+// each folded call is only good for as long as this stays what it was then.
+size_t primitive_redefinitions = 0;
+
 // Funciton that creates and returns a frame
-// Uses talloc for memory managment
-// Takes parent frame as parameter
-Frame *makeFrame(Frame *parent){
-    Frame *new_frame = talloc(sizeof(Frame));
+// Takes parent frame and the number of slots the frame needs (from the analysis pass)
+// Every slot starts out NULL
+Frame *makeFrame(Frame *parent, int size){
+    size_t roots = gcSaveRoots();
+    GC_ROOT(parent);
+
+    STAT(statsFrame(size));
+    Frame *new_frame = gcAlloc(GC_FRAME, sizeof(Frame) + size * sizeof(SchemeItem *));
     new_frame->parent = parent;
-    new_frame->bindings = makeEmpty();
+    new_frame->size = size;
+
+    gcRestoreRoots(roots);
     return new_frame;
 }
 
-// Looks up a variable in the provided frame
-// If it doesn't find it in the provided frame, it will look in the parent frame until the parent frame is NULL
-// Uses pointers to check each binding in the frame, and see if its equal to the provided variable_name
-SchemeItem *findVariableValue(Frame *frame, char *variableName) {
-    Frame *current = frame;
-    while (current != NULL) {
-        // look in this frame before moving on to parent
-        SchemeItem *current_binding = current->bindings;
-        while (current_binding->type == CONS_TYPE) {
-            SchemeItem *pair = current_binding->car;
-
-            SchemeItem *name = pair->car;
-
-            if (name->type == SYMBOL_TYPE && strcmp(name->s, variableName) == 0) {
-                return pair->cdr; // the value of the variable
-            }
-
-            current_binding = current_binding->cdr;
-        }
+// Makes a box holding value, for a variable that closures share (see analyzer.h)
+SchemeItem *makeBox(SchemeItem *value) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(value);
+    SchemeItem *box = makeItem(BOX_TYPE);
+    gcRestoreRoots(roots);
 
-        current = current->parent;
-    }
+    box->contents = value;
+    return box;
+}
 
-    printf("Evaluation error: symbol '%s' wasn't found\n", variableName);
+// Puts a box around the value in a slot of the frame
+void boxSlot(Frame *frame, int index) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(frame);
+    SchemeItem *box = makeBox(frame->slots[index]);
+    gcRestoreRoots(roots);
 
-    texit(1);
-    return NULL;
+    frame->slots[index] = box;
+    gcWriteBarrier(frame);
 }
 
-// Funciton to bind provided bindings to the provided frame
-// Will check if bindings are a linked list, and if each binding is valid
-//
-// Binding format is a cons cell where the car is the variable name and the cdr is the variable value
-//
-// Will prevent duplicate bindings ex. (let ((x 3) (x 5)) x)
-void bindVariables(Frame *frame, SchemeItem *bindings) {
-    if (bindings->type != CONS_TYPE && bindings->type != EMPTY_TYPE){
-        printf("Evaluation error: let bindings must be a list\n");
-        texit(1);
+// Gives a variable of the frame its value, for a define or a letrec init. A boxed
+// variable's slot already holds its box (which nothing else can be in a slot that
+// hasn't been defined yet), and the value goes in that.
+void defineSlot(Frame *frame, int index, SchemeItem *value) {
+    SchemeItem *slot = frame->slots[index];
+    if (slot != NULL && typeOf(slot) == BOX_TYPE) {
+        slot->contents = value;
+        gcWriteBarrier(slot);
+    } else {
+        frame->slots[index] = value;
+        gcWriteBarrier(frame);
     }
+}
 
-    SchemeItem *current_binding = bindings; // pointer to follow bindings linked list
-
-    while (current_binding->type == CONS_TYPE) {
-        // some error checks
-        if (current_binding->car->type != CONS_TYPE) {
-            // let bind is not a list
-            printf("Evaluation error: null binding in let.\n");
-            texit(1);
-        }
-
-        SchemeItem *variable_name = current_binding->car->car;
-        // name must be a symbol
-        if (variable_name->type != SYMBOL_TYPE) {
-            printf("Evaluation error: let variable symbol is not a symbol.\n");
-            texit(1);
-        }
+// Makes a closure of a lambda (a LAMBDA_TYPE node, or a CODE_TYPE item under the
+// VM) and the frame of the variables it captured
+SchemeItem *makeClosure(SchemeItem *lambda, Frame *captured) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(lambda);
+    GC_ROOT(captured);
+    SchemeItem *closure = makeItem(CLOSURE_TYPE);
+    gcRestoreRoots(roots);
+
+    closure->lambda = lambda;
+    closure->frame = captured;
+    closure->name = NULL;
+    return closure;
+}
 
-        SchemeItem *duplicate_check_binding = frame->bindings; // checks the frame that we are currently trying to bind to
-        while (duplicate_check_binding->type == CONS_TYPE) {
-            SchemeItem *pointer_to_variable_cell = duplicate_check_binding->car;
+// Adds a global binding of name to value
+void addBinding(SchemeItem *name, SchemeItem *value) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(value);
 
-            SchemeItem *var_symbol = pointer_to_variable_cell->car;
-            if (var_symbol->type == SYMBOL_TYPE && strcmp(var_symbol->s, variable_name->s) == 0) {
-                printf("Evaluation error: duplicate binding for '%s'\n", variable_name->s);
-                texit(1);
-            }
+    // cons cell that represents binding, made in the old generation so it stays put
+    SchemeItem *pair = gcAllocOld(GC_ITEM, sizeof(SchemeItem));
+    pair->type = CONS_TYPE;
+    pair->car = name;
+    pair->cdr = value;
+    hashTableSet(global_bindings, name, pair);
 
-            duplicate_check_binding = duplicate_check_binding->cdr;
-        }
+    gcRestoreRoots(roots);
+}
 
-        SchemeItem *value_of_binding = eval(current_binding->car->cdr->car, frame->parent); // evaluate the expression
-        SchemeItem *pair = cons(variable_name, value_of_binding); // cons cell that represents binding
+// Returns the (symbol . value) pair of a global, or NULL if it isn't defined.
+// The keys are symbols, which never move, so this never allocates.
+SchemeItem *findGlobalBinding(SchemeItem *symbol) {
+    STAT(statsGlobalLookup());
+    return hashTableRef(global_bindings, symbol);
+}
 
-        frame->bindings = cons(pair, frame->bindings); // add it on to the linked list of bindings for that frame we want
+// Returns how many times a primitive's global has been changed (see primitive_redefinitions)
+size_t primitiveRedefinitions() {
+    return primitive_redefinitions;
+}
 
-        current_binding = current_binding->cdr;
+// Sets a global, given its (symbol . value) pair. Changing one that holds a
+// primitive counts as a redefinition, which turns off every call folded so far.
+void setGlobal(SchemeItem *pair, SchemeItem *value) {
+    if (typeOf(pair->cdr) == PRIMITIVE_TYPE) {
+        primitive_redefinitions++;
     }
+    pair->cdr = value;
+    gcWriteBarrier(pair);
 }
 
-// Helper function to bind variables in a letrec frame
-//
-// First initializes variables to a unassigned value object
-//
-// Then, reassignes by evaluating the expression. This ensures recursive definitions
-//
-// Will throw errors if attempt to call another defined variable ex. (x 3) (y x)
-void bindVariablesLetRec(Frame *frame, SchemeItem *bindings) {
-    SchemeItem *current_binding = bindings;
-
-    while (current_binding->type == CONS_TYPE) {
-
-        SchemeItem *variable_name = current_binding->car->car;
-
-        SchemeItem *duplicate_check_binding = frame->bindings;
-        while (duplicate_check_binding->type == CONS_TYPE) {
-            SchemeItem *pointer_to_variable_cell = duplicate_check_binding->car;
-
-            SchemeItem *var_symbol = pointer_to_variable_cell->car;
-            if (var_symbol->type == SYMBOL_TYPE && strcmp(var_symbol->s, variable_name->s) == 0) {
-                printf("Evaluation error: duplicate binding for '%s'\n", variable_name->s);
-                texit(1);
-            }
-
-            duplicate_check_binding = duplicate_check_binding->cdr;
+// Returns the (symbol . value) pair of a global reference, or NULL if it isn't
+// defined. The reference caches the pair the first time it finds it, so after
+// that this is a single load.
+SchemeItem *globalBinding(SchemeItem *reference) {
+    if (reference->binding == NULL) {
+        SchemeItem *pair = findGlobalBinding(reference->symbol);
+        if (pair == NULL) {
+            return NULL;
         }
-
-        SchemeItem *unspecified_item = makeEmpty();
-        unspecified_item->type = UNSPECIFIED_TYPE;
-        SchemeItem *pair = cons(variable_name, unspecified_item);
-
-        frame->bindings = cons(pair, frame->bindings);
-
-        current_binding = current_binding->cdr;
+        reference->binding = pair;
+        gcWriteBarrier(reference);
     }
+    return reference->binding;
+}
 
+// Returns the frame depth levels out from the given one
+Frame *frameAt(Frame *frame, int depth) {
+    while (depth > 0) {
+        frame = frame->parent;
+        depth--;
+    }
+    return frame;
+}
 
-    current_binding = bindings; // reset it back to the front
-    while (current_binding->type == CONS_TYPE) {
-        SchemeItem *variable_name = current_binding->car->car;
-
-        SchemeItem *expression = current_binding->car->cdr->car;
-        
-        if ((expression != variable_name) && (expression->type == SYMBOL_TYPE)) {
-            printf("Evaluation Error\n");
-            texit(1);
+// Looks up the value of a variable reference made by the analysis pass
+// A local is read straight out of its frame slot (or the box in it), a global is looked up in global_bindings
+SchemeItem *findVariableValue(Frame *frame, SchemeItem *reference) {
+    if (typeOf(reference) != GLOBAL_TYPE) {
+        STAT(statsLocalLookup(reference->depth));
+        SchemeItem *value = frameAt(frame, reference->depth)->slots[reference->index];
+        if (typeOf(reference) == BOXED_TYPE) {
+            value = value->contents;
         }
-
-        SchemeItem *value = eval(expression, frame);
-
-        if (value->type == SYMBOL_TYPE || value->type == UNSPECIFIED_TYPE) {
-            printf("Evaluation Error\n");
-            texit(1);
+        if (value != NULL) {
+            return value;
+        }
+    } else {
+        SchemeItem *pair = globalBinding(reference);
+        if (pair != NULL) {
+            return pair->cdr; // the value of the variable
         }
+    }
 
-        SchemeItem *binding_to_check = frame->bindings;
-        while(binding_to_check->type == CONS_TYPE) {
+    printf("Evaluation error: symbol '%s' wasn't found\n", reference->symbol->s);
 
-            SchemeItem *pair = binding_to_check->car;
-            SchemeItem *pair_name = pair->car;
+    texit(1);
+    return NULL;
+}
 
+// Helper function to evaluate a body (of a let, letrec or function call) in its frame
+//
+// Returns the value of the last expression
+SchemeItem *evalBody(SchemeItem *body, Frame *frame) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(body);
+    GC_ROOT(frame);
 
-            if (strcmp(pair_name->s, variable_name->s) == 0) {
-                pair->cdr = value;
-            }
-            binding_to_check = binding_to_check->cdr;
-        }
+    SchemeItem *last = NULL;
+    while (typeOf(body) == CONS_TYPE) {
+        last = eval(body->car, frame);
+        body = body->cdr;
+    }
+
+    gcRestoreRoots(roots);
+    return last;
+}
 
-        current_binding = current_binding->cdr;
+// Helper function for bodies in tail position
+//
+// Evaluates every expression of a (non-empty) body but the last one, and returns the last
+// one without evaluating it, so eval can carry on with it instead of recursing
+SchemeItem *evalToTail(SchemeItem *body, Frame *frame) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(body);
+    GC_ROOT(frame);
+
+    while (typeOf(body->cdr) == CONS_TYPE) {
+        eval(body->car, frame);
+        body = body->cdr;
     }
+
+    gcRestoreRoots(roots);
+    return body->car;
 }
 
+// The special form helpers below all take the form's arguments, a pointer to the frame
+// eval is working in, and a tail flag. A helper either returns a value, or sets *tail and
+// returns the expression in tail position, which eval then evaluates in *frame (a helper
+// can point that at a new frame, like let does). This way tail calls don't use up any C
+// stack. eval keeps its frame rooted, so helpers read *frame again after allocating.
+
 // Helper function to evaluate if function
-// First, checks if the provided amount of args is valid
+// The analysis pass has already checked that there are 3 args
 // 
-// Then evaluates the test expression. If anything but #f, evaluate true_expression
-// Otherwise, evaluate false_expression
-SchemeItem *evalIf(SchemeItem *args, Frame *frame) {
-    if (length(args) != 3) {
-        printf("Evaluation error: args length isn't 3.\n");
-        texit(1);
-    }
+// Evaluates the test expression. If anything but #f, true_expression is in tail position
+// Otherwise, false_expression is
+SchemeItem *evalIf(SchemeItem *args, Frame **frame, bool *tail) {
     SchemeItem *test = args->car; // condition we have to meet
     SchemeItem *true_express  = args->cdr->car;
     SchemeItem *false_express  = args->cdr->cdr->car;
 
-    SchemeItem *test_evaluted = eval(test, frame);
+    size_t roots = gcSaveRoots();
+    GC_ROOT(true_express);
+    GC_ROOT(false_express);
 
-    if (test_evaluted->type == BOOL_TYPE && strcmp(test_evaluted->s, "#f") == 0) {
-        return eval(false_express, frame);
+    SchemeItem *test_evaluted = eval(test, *frame);
+    gcRestoreRoots(roots);
+
+    *tail = true;
+    if (isFalse(test_evaluted)) {
+        return false_express;
     } else {
-        return eval(true_express, frame);
+        return true_express;
     }
 }
 
-// Helper function to evaluate let statements
-// First, checks to see if the body statement is valid
-//
-// Will then bind variables to a new frame, using bindVariables helper function
-//
-// Will use a pointer (current) to loop through and execute each body statement after binding
-//
-// Returns the final value/statement after body expressions are executed
-SchemeItem *evalLet(SchemeItem *args, Frame *frame) {
-    SchemeItem *bindings_list = args->car;
-    SchemeItem *body_list = args->cdr;
-
-    if (body_list->type == EMPTY_TYPE) {
-        printf("Evaluation error: let body is empty.\n");
-        texit(1);
+// Gives a closure the name of the variable it is being bound to, for the profiler,
+// when it was made by a lambda written right there. Then a closure is named by the
+// define, let or letrec that made it, however it is passed around afterwards.
+void nameClosure(SchemeItem *value, SchemeItem *expr, SchemeItem *name) {
+    if (typeOf(expr) == LAMBDA_TYPE && typeOf(value) == CLOSURE_TYPE) {
+        value->name = name;
     }
+}
 
-    Frame *new_frame = makeFrame(frame); // parent = frame
-
-    bindVariables(new_frame, bindings_list);
-
-    // evaluate the bodys
-    SchemeItem *current = body_list;
-
-    SchemeItem *last = NULL;
-
-    while (current->type == CONS_TYPE) {
-        last = eval(current->car, new_frame);
-
-        current = current->cdr;
+// Helper function to evaluate let statements, in the form (SIZE ((NAME . INIT)...) BODY...)
+// left by the analysis pass
+//
+// Each init is evaluated in the enclosing frame and stored in its slot of a new frame,
+// then the body is evaluated in the new frame, with its last expression in tail position
+SchemeItem *evalLet(SchemeItem *args, Frame **frame, bool *tail) {
+    SchemeItem *inits = args->cdr->car;
+    SchemeItem *body_list = args->cdr->cdr;
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(inits);
+    GC_ROOT(body_list);
+
+    Frame *new_frame = makeFrame(*frame, fixnumValue(args->car)); // parent = frame
+    GC_ROOT(new_frame);
+
+    int index = 0;
+    while (typeOf(inits) == CONS_TYPE) {
+        SchemeItem *value = eval(inits->car->cdr, *frame);
+        nameClosure(value, inits->car->cdr, inits->car->car);
+        new_frame->slots[index] = value;
+        gcWriteBarrier(new_frame);
+
+        index++;
+        inits = inits->cdr;
     }
 
-    return last;
+    *frame = new_frame;
+    *tail = true;
+    gcRestoreRoots(roots);
+    return evalToTail(body_list, *frame);
 }
 
-// Helper function to evaluate let rec statments
+// Helper function to evaluate let rec statments, in the same form as let
 //
-// Creates a new frame
+// First initializes variables to a unassigned value object, so the inits (which are
+// evaluated in the new frame) can refer to each other. The body's boxes are made
+// before any init runs, since a closure an init makes may capture them
 //
-// Then, uses bindVariablesLetRec to specifically bind variables
+// Will throw errors if an init evaluates to an unassigned variable
 //
-// Returns the last body
-SchemeItem *evalLetRec(SchemeItem *args, Frame *frame) {
-    // create a new frame with parent env
-    SchemeItem *bindings_list = args->car;
-    SchemeItem *body_list = args->cdr;
+// The last body is in tail position
+SchemeItem *evalLetRec(SchemeItem *args, Frame **frame, bool *tail) {
+    SchemeItem *inits = args->cdr->car;
+    SchemeItem *body_list = args->cdr->cdr;
 
-    Frame *new_frame = makeFrame(frame);
+    size_t roots = gcSaveRoots();
+    GC_ROOT(inits);
+    GC_ROOT(body_list);
 
-    bindVariablesLetRec(new_frame, bindings_list);
+    Frame *new_frame = makeFrame(*frame, fixnumValue(args->car));
+    GC_ROOT(new_frame);
+
+    for (int i = 0; i < new_frame->size; i++) {
+        new_frame->slots[i] = SCHEME_UNSPECIFIED;
+    }
+    while (typeOf(body_list->car) == MAKEBOX_TYPE) {
+        boxSlot(new_frame, body_list->car->index);
+        body_list = body_list->cdr;
+    }
 
-    // evaluate the bodys
-    SchemeItem *current = body_list;
+    int index = 0;
+    while (typeOf(inits) == CONS_TYPE) {
+        SchemeItem *value = eval(inits->car->cdr, new_frame);
+        nameClosure(value, inits->car->cdr, inits->car->car);
 
-    SchemeItem *last = NULL;
+        if (typeOf(value) == SYMBOL_TYPE || value == SCHEME_UNSPECIFIED) {
+            printf("Evaluation Error\n");
+            texit(1);
+        }
 
-    while (current->type == CONS_TYPE) {
-        last = eval(current->car, new_frame);
+        defineSlot(new_frame, index, value);
 
-        current = current->cdr;
+        index++;
+        inits = inits->cdr;
     }
 
-    return last;
+    *frame = new_frame;
+    *tail = true;
+    gcRestoreRoots(roots);
+    return evalToTail(body_list, *frame);
 }
 
 // Helper function to evaluate set
 //
-// Will check for two arguments
-//
 // Expression is evaluated in the provided frame (current frame)
 //
-// Will check to see if variable name is in current frame
+// Reassignes the variable's slot (or global binding) to the evaluated expression
 //
-// If not, will check through parents
-//
-// Reassignes that variable names value to the evaluated expression
-//
-// If not found once reaches parent frame, throws an error
-SchemeItem *evalSet(SchemeItem *args, Frame *frame) {
-    if (length(args) != 2) {
-        printf("Evaluation error: set! takes 2 arguments\n");
-        texit(1);
-    }
-
-    SchemeItem *name  = args->car;
-    SchemeItem *value = eval(args->cdr->car, frame);
-
-    Frame *current = frame;
-    while (current != NULL) {
-        SchemeItem *binding = current->bindings;
-
-        while (binding->type == CONS_TYPE) {
-            SchemeItem *pair = binding->car;
-            SchemeItem *var_symbol = pair->car;
-
-            if ((var_symbol->type == SYMBOL_TYPE) && (strcmp(var_symbol->s, name->s) == 0)) {
-                pair->cdr = value;
-                SchemeItem *void_thing = makeEmpty();
-                void_thing->type = VOID_TYPE;
-                return void_thing;
-            }
-            binding = binding->cdr;
+// If the variable hasn't been bound yet, throws an error
+SchemeItem *evalSet(SchemeItem *args, Frame **frame, bool *tail) {
+    SchemeItem *reference  = args->car;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(reference);
+
+    SchemeItem *value = eval(args->cdr->car, *frame);
+    gcRestoreRoots(roots);
+
+    if (typeOf(reference) == LOCAL_TYPE) {
+        Frame *target = frameAt(*frame, reference->depth);
+        if (target->slots[reference->index] != NULL) {
+            target->slots[reference->index] = value;
+            gcWriteBarrier(target);
+            return SCHEME_VOID;
+        }
+    } else if (typeOf(reference) == BOXED_TYPE) {
+        SchemeItem *box = frameAt(*frame, reference->depth)->slots[reference->index];
+        if (box->contents != NULL) {
+            box->contents = value;
+            gcWriteBarrier(box);
+            return SCHEME_VOID;
+        }
+    } else {
+        SchemeItem *pair = globalBinding(reference);
+        if (pair != NULL) {
+            setGlobal(pair, value);
+            return SCHEME_VOID;
         }
-        current = current->parent;
     }
     printf("Evaluation error\n");
     texit(1);
@@ -312,159 +397,284 @@ SchemeItem *evalSet(SchemeItem *args, Frame *frame) {
 // Does not wrap the quoted expression in a closure
 //
 // Instead, just returns the already structed CONS linked list in the car of the args
-//
-// If more or less than 1 argument is passed, will produce an error
-SchemeItem *evalQuote (SchemeItem *args, Frame *frame) {
-    if (length(args) != 1) {
-        printf("Evaluation error\n");
-        texit(1);
-    }
+SchemeItem *evalQuote (SchemeItem *args, Frame **frame, bool *tail) {
     return args->car;
 }
 
 // Helper function to evaluate define statements
 //
-// Checks that name is a symbol and that there are no duplicate bindings for frame we are in
+// A global can only be defined once. An internal define stores into the slot the
+// analysis pass gave it in the current frame
 //
 // Evaluates provided expr and assigns value to variable / binding name
 //
 // Returns an object that is void_type, per assignment
-SchemeItem *evalDefine (SchemeItem *args, Frame *frame) {
-    if (length(args) != 2) {
-        printf("Evaluation error\n");
+SchemeItem *evalDefine (SchemeItem *args, Frame **frame, bool *tail) {
+    SchemeItem *reference = args->car;
+
+    if (typeOf(reference) == GLOBAL_TYPE && findGlobalBinding(reference->symbol) != NULL) {
+        printf("Evaluation error: duplicate binding for '%s'\n", reference->symbol->s);
         texit(1);
     }
 
-    SchemeItem *name = args->car;
-    if (name->type != SYMBOL_TYPE) {
-        printf("Evaluation error: define name must be a symbol\n");
-        texit(1);
+    size_t roots = gcSaveRoots();
+    GC_ROOT(reference);
+
+    SchemeItem *expr = args->cdr->car;
+    GC_ROOT(expr);
+    SchemeItem *value = eval(expr, *frame); // evaluate the expression
+    nameClosure(value, expr, reference->symbol);
+    if (typeOf(reference) == GLOBAL_TYPE) {
+        addBinding(reference->symbol, value);
+    } else {
+        defineSlot(*frame, reference->index, value);
     }
+    gcRestoreRoots(roots);
 
-    // check if we are duplicate binding in the provided frame (frame we are defining in)
-    SchemeItem *duplicate_check_binding = frame->bindings;
-    while (duplicate_check_binding->type == CONS_TYPE) {
-        SchemeItem *pointer_to_variable_cell = duplicate_check_binding->car;
+    return SCHEME_VOID;
+}
 
-        SchemeItem *var_symbol = pointer_to_variable_cell->car;
-        if (var_symbol->type == SYMBOL_TYPE && strcmp(var_symbol->s, name->s) == 0) {
-            printf("Evaluation error: duplicate binding for '%s'\n", name->s);
-            texit(1);
-        }
 
-        duplicate_check_binding = duplicate_check_binding->cdr;
+// Helper function to evaluate lambda expressions
+//
+// Creates a closure from the analyzed lambda, copying the slots of the variables it
+// captures out of the frame it was created in (a boxed variable's slot holds its box,
+// so the closure shares that). A lambda that captures nothing needs no frame at all
+SchemeItem *evalLambda (SchemeItem *lambda, Frame *frame) {
+    int count = length(lambda->captures);
+    if (count == 0) {
+        return makeClosure(lambda, NULL);
     }
 
-    SchemeItem *expr = args->cdr->car;
-    SchemeItem *value = eval(expr, frame); // evaluate the expression
-    SchemeItem *pair = cons(name, value);
-    frame->bindings = cons(pair, frame->bindings); // add on to the bindings in the current frame
+    size_t roots = gcSaveRoots();
+    GC_ROOT(lambda);
+    GC_ROOT(frame);
+
+    Frame *captured = makeFrame(NULL, count);
+    SchemeItem *current = lambda->captures;
+    for (int i = 0; i < count; i++) {
+        SchemeItem *reference = current->car;
+        captured->slots[i] = frameAt(frame, reference->depth)->slots[reference->index];
+        current = current->cdr;
+    }
 
-    SchemeItem *void_thing = makeEmpty();
-    void_thing->type = VOID_TYPE;
-    return void_thing;
+    gcRestoreRoots(roots);
+    return makeClosure(lambda, captured);
 }
 
+// Helper function to evaluate begin statements
+//
+// Evaluates each expression in order, the last one in tail position
+//
+// An empty begin returns a void object
+SchemeItem *evalBegin(SchemeItem *args, Frame **frame, bool *tail) {
+    if (typeOf(args) != CONS_TYPE) {
+        return SCHEME_VOID;
+    }
+    *tail = true;
+    return evalToTail(args, *frame);
+}
 
-// Helper function to evaluate lambda expressions
+// Helper function to evaluate cond statements
+//
+// Goes through the clauses in order, evaluating each test until one is not #f, then
+// evaluates that clause's body, the last expression in tail position (if the body is
+// empty, the test's value is returned). A clause whose test is the symbol else always matches.
 //
-// Creates a closure that takes parameters and has the code for the function
+// Returns a void object if no clause matches
+SchemeItem *evalCond(SchemeItem *args, Frame **frame, bool *tail) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
+
+    SchemeItem *else_symbol = intern("else");
+    SchemeItem *result = NULL;
+
+    while (typeOf(args) == CONS_TYPE) {
+        SchemeItem *clause = args->car;
+        SchemeItem *test_evaluated;
+        if (clause->car == else_symbol) {
+            test_evaluated = else_symbol;
+        } else {
+            test_evaluated = eval(clause->car, *frame);
+        }
+
+        if (!isFalse(test_evaluated)) {
+            result = test_evaluated;
+            if (typeOf(args->car->cdr) == CONS_TYPE) {
+                *tail = true;
+                result = evalToTail(args->car->cdr, *frame);
+            }
+            break;
+        }
+
+        args = args->cdr;
+    }
+    gcRestoreRoots(roots);
+
+    if (result == NULL) {
+        result = SCHEME_VOID;
+    }
+    return result;
+}
+
+// Helper function to evaluate and statements
 //
-// Checks to make sure the parameter list is valid (symbols, and no duplicates)
+// Evaluates each expression in order, stopping at the first one that is #f
 //
-// Stores paramNames and body on the closure, then returns it
-SchemeItem *evalLambda (SchemeItem *args, Frame *frame) {
-    if (length(args) < 2) {
-        printf("Evaluation error\n");
-        texit(1);
+// The last expression is in tail position. Returns #t if there are no expressions
+SchemeItem *evalAnd(SchemeItem *args, Frame **frame, bool *tail) {
+    if (typeOf(args) != CONS_TYPE) {
+        return makeBool(true);
     }
-    // make closure
-    SchemeItem *closure = makeEmpty();
-    closure->type = CLOSURE_TYPE;
 
-    if (args->car->type == CONS_TYPE) {
-        SchemeItem *current = args->car;
-        while (current->type == CONS_TYPE) {
-            if (current->car->type != SYMBOL_TYPE) {
-                printf("Evaluation error\n");
-                texit(1);
-            }
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
 
-            SchemeItem *rest = current->cdr;
+    while (typeOf(args->cdr) == CONS_TYPE) {
+        SchemeItem *value = eval(args->car, *frame);
+        if (isFalse(value)) {
+            gcRestoreRoots(roots);
+            return value;
+        }
+        args = args->cdr;
+    }
 
-            while (rest->type == CONS_TYPE) {
-                if (strcmp(current->car->s, rest->car->s) == 0) {
-                    printf("Evaluation error: duplicate identifier\n");
-                    texit(1);
-                }
-                rest = rest->cdr;
-            }
+    gcRestoreRoots(roots);
+    *tail = true;
+    return args->car;
+}
+
+// Helper function to evaluate or statements
+//
+// Evaluates each expression in order, stopping at the first one that isn't #f
+//
+// The last expression is in tail position. Returns #f if there are no expressions
+SchemeItem *evalOr(SchemeItem *args, Frame **frame, bool *tail) {
+    if (typeOf(args) != CONS_TYPE) {
+        return makeBool(false);
+    }
 
-            current = current->cdr;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
+
+    while (typeOf(args->cdr) == CONS_TYPE) {
+        SchemeItem *value = eval(args->car, *frame);
+        if (!isFalse(value)) {
+            gcRestoreRoots(roots);
+            return value;
         }
+        args = args->cdr;
+    }
+
+    gcRestoreRoots(roots);
+    *tail = true;
+    return args->car;
+}
+
+// Creates the frame for a call to a closure, with the closure's frame as the parent, and
+// puts the arguments in its first slots (any extra arguments go in a list in the rest slot)
+Frame *bindArguments(SchemeItem *function, SchemeItem *args) {
+    SchemeItem *lambda = function->lambda;
+    int arg_count = length(args);
+    if (arg_count < lambda->paramCount || (!lambda->rest && arg_count != lambda->paramCount)) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
     }
 
-    closure->paramNames = args->car;
-    
-    closure->frame = frame;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(function);
+    GC_ROOT(args);
 
-    closure->functionCode = args->cdr;
+    // parent is the same as where the function was defined
+    Frame *frame = makeFrame(function->frame, lambda->frameSize);
+    lambda = function->lambda;
 
-    return closure;
+    for (int i = 0; i < lambda->paramCount; i++) {
+        frame->slots[i] = args->car;
+        args = args->cdr;
+    }
+    if (lambda->rest) {
+        frame->slots[lambda->paramCount] = args;
+    }
+
+    gcRestoreRoots(roots);
+    return frame;
 }
 
-// Binds the actual parameter values for a frame that is created on function call to the parameter names
+// Evaluates a closure's body in a new frame from bindArguments (eval does this itself
+// for calls, so that they can be tail calls)
 //
-// Will bind differently depending on lambda format
-void bindParameters(Frame *frame, SchemeItem *paramNames, SchemeItem *args) {
-    // (lambda (a1 a2 ... an) body1 body2 ... bodym)
-    if (paramNames->type == CONS_TYPE || paramNames->type == EMPTY_TYPE) {
-        while (paramNames->type == CONS_TYPE && args->type == CONS_TYPE) {
-            SchemeItem *pair = cons(paramNames->car, args->car);
-            frame->bindings = cons(pair, frame->bindings);
-            paramNames  = paramNames->cdr;
-            args  = args->cdr;
+// Returns the final value of the body list
+SchemeItem *applyClosure(SchemeItem *function, SchemeItem *args) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(function);
+
+    Frame *frame = bindArguments(function, args);
+    profileEnter(function);
+
+    gcRestoreRoots(roots);
+    SchemeItem *result = evalBody(function->lambda->body, frame);
+    profileLeave();
+    return result;
+}
+
+// The most arguments callFixed evaluates into its buffer
+#define FIXED_MAX_ARGS 8
+
+// Calls a primitive that has an array entry point (see fixed in schemeitem.h),
+// evaluating the argument expressions into a buffer on the C stack rather than
+// into a list, so the call itself allocates nothing. Returns NULL, without
+// evaluating anything, if there are more arguments than fit.
+SchemeItem *callFixed(SchemeItem *function, SchemeItem *args, Frame *frame) {
+    int count = 0;
+    for (SchemeItem *current = args; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        count++;
+        if (count > FIXED_MAX_ARGS) {
+            return NULL;
         }
-        return;
     }
-    // (lambda args body1 body2 ... bodym)
-    if (paramNames->type == SYMBOL_TYPE) {
-        SchemeItem *pair = cons(paramNames, args);
-        frame->bindings = cons(pair, frame->bindings);
-        return;
+
+    SchemeItem *values[FIXED_MAX_ARGS];
+    size_t roots = gcSaveRoots();
+    GC_ROOT(function);
+    GC_ROOT(args);
+    GC_ROOT(frame);
+    for (int i = 0; i < count; i++) {
+        values[i] = eval(args->car, frame);
+        GC_ROOT(values[i]);
+        args = args->cdr;
     }
+
+    STAT(statsApply(false));
+    SchemeItem *result = function->fixed(values, count);
+    gcRestoreRoots(roots);
+    return result;
 }
 
 // Applies a function to evalauted arguments
-//
-// Creates a frame for the function call with the closure's parent as the parent
-//
-// Evaluates body(s) in that frame
-//
-// Returns the final value of the body list
 SchemeItem *apply(SchemeItem *function, SchemeItem *args) {
-    if (function->type == CLOSURE_TYPE) {
-        // make a frame for the function call, and bind parameters
-        // parent is the same as where the function was defined
-        Frame *frame = makeFrame(function->frame);
-        bindParameters(frame, function->paramNames, args); 
-
-        // evaluate body, then return 
-        SchemeItem *body = function->functionCode;
-
-        SchemeItem *last = NULL;
-        while (body->type == CONS_TYPE) {
-            last = eval(body->car, frame);
-            body = body->cdr;
-        }
-        return last;
-    } else if (function->type == PRIMITIVE_TYPE) {
+    STAT(statsApply(typeOf(function) == CLOSURE_TYPE));
+    if (typeOf(function) == CLOSURE_TYPE) {
+        return applyClosure(function, args);
+    } else if (typeOf(function) == PRIMITIVE_TYPE) {
         return function->pf(args);
     } else {
+        printf("Evaluation error: not a procedure\n");
+        texit(1);
         return NULL;
     }
 }
 
+// Calls a procedure from C, for primitives that take one. A closure made by the VM
+// (whose lambda is compiled code) has to be run by the VM
+SchemeItem *callProcedure(SchemeItem *function, SchemeItem *args) {
+    if (typeOf(function) == CLOSURE_TYPE && typeOf(function->lambda) == CODE_TYPE) {
+        return vmApply(function, args);
+    }
+    return apply(function, args);
+}
+
+
 /*
  *****************************************************************************
  *                                                                           *
@@ -473,54 +683,80 @@ SchemeItem *apply(SchemeItem *function, SchemeItem *args) {
  *****************************************************************************
  */
 
-// Primitive functin for the less than function in scheme '<'
-//
-// Will ensure there are two arguments
-// 
-// Checks to make sure type INT or DOUBLE, accessing proper scheme item value for the type
-//
-// Returns a bool scheme item of the result
-SchemeItem *primitiveLessThan(SchemeItem *args) {
-    if (length(args) != 2) {
-        printf("Evaluation error: too many args\n");
-        texit(1);
+// Checks for folding (see canFold in schemeitem.h). Each accepts only arguments
+// its primitives can't fail on, and there's no harm in turning down others.
+
+// Returns whether every item of a list is a number
+bool allNumbers(SchemeItem *args) {
+    for (; typeOf(args) == CONS_TYPE; args = args->cdr) {
+        if (!isNumber(args->car)) {
+            return false;
+        }
     }
+    return true;
+}
 
-    SchemeItem *bool_item = makeEmpty();
-    bool_item->type = BOOL_TYPE;
-    bool_item->s = talloc(sizeof(2));
+// For + and *
+bool canFoldArithmetic(SchemeItem *args) {
+    return allNumbers(args);
+}
 
-    if ((args->car->type == INT_TYPE && args->cdr->car->type == INT_TYPE) || (args->car->type == DOUBLE_TYPE && args->cdr->car->type == DOUBLE_TYPE)) {
-        if (args->car->type == INT_TYPE) {
-            if (args->car->i < args->cdr->car->i) {
-                strcpy(bool_item->s, "#t");
-            } else {
-                strcpy(bool_item->s, "#f");
-            }
-        } else if (args->car->type == DOUBLE_TYPE) {
-            if (args->car->d < args->cdr->car->d) {
-                strcpy(bool_item->s, "#t");
-            } else {
-                strcpy(bool_item->s, "#f");
-            }
-        } else {
-            printf("Evaluation error\n");
-            texit(1);
+// For -, which needs an argument
+bool canFoldSubtract(SchemeItem *args) {
+    return typeOf(args) == CONS_TYPE && allNumbers(args);
+}
+
+// For /, which mustn't divide by zero (the only argument, or any after the first)
+bool canFoldDivide(SchemeItem *args) {
+    if (!canFoldSubtract(args)) {
+        return false;
+    }
+    SchemeItem *divisors = typeOf(args->cdr) == CONS_TYPE ? args->cdr : args;
+    for (; typeOf(divisors) == CONS_TYPE; divisors = divisors->cdr) {
+        if (numberCompare(divisors->car, makeFixnum(0)) == 0) {
+            return false;
         }
-    } else {
-        printf("Evaluation error\n");
-        texit(1);
     }
+    return true;
+}
+
+// For quotient, remainder and modulo: two exact integers, the second not 0
+bool canFoldIntegerDivision(SchemeItem *args) {
+    return length(args) == 2 && isExactInteger(args->car) && isExactInteger(args->cdr->car)
+        && args->cdr->car != makeFixnum(0);
+}
+
+// For =, <, >, <= and >=
+bool canFoldComparison(SchemeItem *args) {
+    return length(args) >= 2 && allNumbers(args);
+}
+
+// For zero?, abs and exact->inexact
+bool canFoldNumber(SchemeItem *args) {
+    return length(args) == 1 && isNumber(args->car);
+}
+
+// For number?, integer? and null?, which take anything
+bool canFoldOneArg(SchemeItem *args) {
+    return length(args) == 1;
+}
 
-    return bool_item;
+// For eq? and equal?
+bool canFoldTwoArgs(SchemeItem *args) {
+    return length(args) == 2;
+}
 
+// For car and cdr
+bool canFoldPair(SchemeItem *args) {
+    return length(args) == 1 && typeOf(args->car) == CONS_TYPE;
 }
 
 // Primitive function equal in scheme "equal?"
 //
 // Ensures it has two arguments
 //
-// Currently only able to compare of type INT, DOUBLE, or STR. (not cons)
+// Compares numbers and strings by value, and lists and vectors element by
+// element (see isEqual)
 //
 // Returns a scheme item bool with the result
 SchemeItem *primitiveEqual(SchemeItem *args) {
@@ -528,38 +764,16 @@ SchemeItem *primitiveEqual(SchemeItem *args) {
         printf("Evaluation error: too many args\n");
         texit(1);
     }
+    return makeBool(isEqual(args->car, args->cdr->car));
+}
 
-    SchemeItem *bool_item = makeEmpty();
-    bool_item->type = BOOL_TYPE;
-    bool_item->s = talloc(sizeof(2));
-
-    if ((args->car->type == INT_TYPE && args->cdr->car->type == INT_TYPE) || (args->car->type == DOUBLE_TYPE && args->cdr->car->type == DOUBLE_TYPE)) {
-        if (args->car->type == INT_TYPE) {
-            if (args->car->i == args->cdr->car->i) {
-                strcpy(bool_item->s, "#t");
-            } else {
-                strcpy(bool_item->s, "#f");
-            }
-        } else if (args->car->type == DOUBLE_TYPE) {
-            if (args->car->d == args->cdr->car->d) {
-                strcpy(bool_item->s, "#t");
-            } else {
-                strcpy(bool_item->s, "#f");
-            }
-        }
-    } else if (args->car->type == STR_TYPE && args->cdr->car->type == STR_TYPE) {
-        if (strcmp(args->car->s, args->cdr->car->s) == 0) {
-            strcpy(bool_item->s, "#t");
-        } else {
-            strcpy(bool_item->s, "#f");
-        }   
-    } else if (args->car->type == CONS_TYPE && args->cdr->car->type == CONS_TYPE) {
-        // do something for cons
-    } else {
-        strcpy(bool_item->s, "#f");
+// Primitive function eq?: whether its two arguments are the same object
+SchemeItem *primitiveEq(SchemeItem *args) {
+    if (length(args) != 2) {
+        printf("Evaluation error: too many args\n");
+        texit(1);
     }
-
-    return bool_item;
+    return makeBool(args->car == args->cdr->car);
 }
 
 
@@ -567,7 +781,7 @@ SchemeItem *primitiveEqual(SchemeItem *args) {
 //
 // Will check to see only one argument provided, and that the type is a list
 SchemeItem *primitiveCar(SchemeItem *args) {
-    if (length(args) != 1 || args->car->type != CONS_TYPE) {
+    if (length(args) != 1 || typeOf(args->car) != CONS_TYPE) {
         printf("Evaluation error\n");
         texit(1);
     }
@@ -578,7 +792,7 @@ SchemeItem *primitiveCar(SchemeItem *args) {
 //
 // Will check to see only one argument provided, and that the type is a list
 SchemeItem *primitiveCdr(SchemeItem *args) {
-    if (length(args) != 1 || args->type != CONS_TYPE) {
+    if (length(args) != 1 || typeOf(args->car) != CONS_TYPE) {
         printf("Evaluation error\n");
         texit(1);
     }
@@ -595,83 +809,383 @@ SchemeItem *primitiveNull(SchemeItem *args) {
         printf("Evaluation error\n");
         texit(1);
     }
-    SchemeItem *bool_item = makeEmpty();
-    bool_item->type = BOOL_TYPE;
-    bool_item->s = talloc(sizeof(2));
+    return makeBool(args->car == SCHEME_EMPTY);
+}
 
-    if (args->car->type == EMPTY_TYPE) {
-        strcpy(bool_item->s, "#t");
-    } else {
-        strcpy(bool_item->s, "#f");
+// Combines a running total with each number in args in turn, from the left. The
+// arithmetic itself (and the checking that everything is a number) is in number.c
+SchemeItem *foldNumbers(SchemeItem *total, SchemeItem *args, SchemeItem *(*combine)(SchemeItem *, SchemeItem *)) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(total);
+    GC_ROOT(args);
+    while (typeOf(args) == CONS_TYPE) {
+        total = combine(total, args->car);
+        args = args->cdr;
     }
-
-    return bool_item;
+    gcRestoreRoots(roots);
+    return total;
 }
 
 // Primitive implementation of function +
 //
-// Will add up to the value total as it goes through the list
-//
-// Properly handles both double and int types, casting to int at the end if int type (double by default)
+// Fixnums are summed straight into a long for as long as the total stays a
+// fixnum, which is nearly always; anything else carries on through numberAdd
 //
-// Will throw errors if an element of the list is not a double or int type
-//
-// Will return 0 if no args provided
+// Returns 0 if no args provided
 SchemeItem *primitiveAdd(SchemeItem *args) {
-    if (length(args) == 0) {
-        SchemeItem *total_item = makeEmpty();
-        total_item->type = INT_TYPE; // change this
-        total_item->i = 0;
-        return total_item;
-    }
-
-    double total = 0;
-    bool is_int = true;
-
+    long total = 0;
     SchemeItem *current = args;
-    while (current->type == CONS_TYPE) {
-        SchemeItem *number_item = current->car;
-        if (number_item->type != DOUBLE_TYPE && number_item->type != INT_TYPE) {
-            printf("Evaluation error\n");
-            texit(1);
-        }
-
-        if (number_item->type == INT_TYPE) {
-            total = total + number_item->i;
-        }
-        if (number_item->type == DOUBLE_TYPE) {
-            is_int = false;
-            total = total + number_item->d;
-        }
-
+    while (typeOf(current) == CONS_TYPE && typeOf(current->car) == INT_TYPE) {
+        total = total + fixnumValue(current->car);
         current = current->cdr;
+        if (total > FIXNUM_MAX || total < FIXNUM_MIN) {
+            break;
+        }
     }
-
-    SchemeItem *total_item = makeEmpty();
-    if (is_int) {
-        total_item->type = INT_TYPE;
-        total_item->i = (int)total;
-    } else {
-        total_item->type = DOUBLE_TYPE;
-        total_item->d = total;
+    if (typeOf(current) != CONS_TYPE) {
+        return makeInteger(total);
     }
 
-    return total_item;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(current);
+    SchemeItem *sum = makeInteger(total);
+    gcRestoreRoots(roots);
+    return foldNumbers(sum, current, numberAdd);
 }
 
-// Primitive implementation of function cons
+// Primitive implementation of function *
 //
-// Will check to see that exactly two arguments provided
-SchemeItem *primitiveCons(SchemeItem *args) {
+// Returns 1 if no args provided
+SchemeItem *primitiveMultiply(SchemeItem *args) {
+    return foldNumbers(makeFixnum(1), args, numberMultiply);
+}
+
+// Primitive implementation of function -
+//
+// With one argument, negates it. Otherwise subtracts the rest from the first
+SchemeItem *primitiveSubtract(SchemeItem *args) {
+    if (typeOf(args) != CONS_TYPE) {
+        printf("Evaluation error: - needs at least one argument\n");
+        texit(1);
+    }
+    if (typeOf(args->cdr) != CONS_TYPE) {
+        return numberSubtract(makeFixnum(0), args->car);
+    }
+    if (args->cdr->cdr == SCHEME_EMPTY) {
+        return numberSubtract(args->car, args->cdr->car);
+    }
+    return foldNumbers(args->car, args->cdr, numberSubtract);
+}
+
+// Primitive implementation of function /
+//
+// With one argument, returns its reciprocal. An exact division that doesn't come
+// out even gives a double, since there are no rationals
+SchemeItem *primitiveDivide(SchemeItem *args) {
+    if (typeOf(args) != CONS_TYPE) {
+        printf("Evaluation error: / needs at least one argument\n");
+        texit(1);
+    }
+    if (typeOf(args->cdr) != CONS_TYPE) {
+        return numberDivide(makeFixnum(1), args->car);
+    }
+    return foldNumbers(args->car, args->cdr, numberDivide);
+}
+
+// Checks that a primitive got exactly two arguments
+void checkTwoArgs(SchemeItem *args) {
     if (length(args) != 2) {
+        printf("Evaluation error: expected two arguments\n");
+        texit(1);
+    }
+}
+
+// Primitive implementations of quotient, remainder and modulo
+SchemeItem *primitiveQuotient(SchemeItem *args) {
+    checkTwoArgs(args);
+    return numberQuotient(args->car, args->cdr->car);
+}
+
+SchemeItem *primitiveRemainder(SchemeItem *args) {
+    checkTwoArgs(args);
+    return numberRemainder(args->car, args->cdr->car);
+}
+
+SchemeItem *primitiveModulo(SchemeItem *args) {
+    checkTwoArgs(args);
+    return numberModulo(args->car, args->cdr->car);
+}
+
+// Checks that each number in args compares to the next one the way the
+// comparison wants: less, equal and greater say which results of numberCompare
+// are allowed (a NaN compares false with everything). Every argument must be a
+// number, and there must be at least two
+SchemeItem *compareNumbers(SchemeItem *args, bool less, bool equal, bool greater) {
+    if (typeOf(args) != CONS_TYPE || typeOf(args->cdr) != CONS_TYPE) {
+        printf("Evaluation error: comparison needs at least two arguments\n");
+        texit(1);
+    }
+    bool result = true;
+    while (typeOf(args->cdr) == CONS_TYPE) {
+        int order = numberCompare(args->car, args->cdr->car);
+        if (order == NUMBER_UNORDERED || (order < 0 && !less) || (order == 0 && !equal) || (order > 0 && !greater)) {
+            result = false;
+        }
+        args = args->cdr;
+    }
+    return makeBool(result);
+}
+
+// Primitive implementations of =, <, >, <= and >=
+SchemeItem *primitiveNumberEqual(SchemeItem *args) {
+    return compareNumbers(args, false, true, false);
+}
+
+SchemeItem *primitiveLessThan(SchemeItem *args) {
+    return compareNumbers(args, true, false, false);
+}
+
+SchemeItem *primitiveGreaterThan(SchemeItem *args) {
+    return compareNumbers(args, false, false, true);
+}
+
+SchemeItem *primitiveLessOrEqual(SchemeItem *args) {
+    return compareNumbers(args, true, true, false);
+}
+
+SchemeItem *primitiveGreaterOrEqual(SchemeItem *args) {
+    return compareNumbers(args, false, true, true);
+}
+
+// Checks that a primitive got exactly one argument
+void checkOneArg(SchemeItem *args) {
+    if (length(args) != 1) {
+        printf("Evaluation error: expected one argument\n");
+        texit(1);
+    }
+}
+
+// Primitive implementation of function number?
+SchemeItem *primitiveIsNumber(SchemeItem *args) {
+    checkOneArg(args);
+    return makeBool(isNumber(args->car));
+}
+
+// Primitive implementation of function integer?, which is true of a double with
+// no fractional part too
+SchemeItem *primitiveIsInteger(SchemeItem *args) {
+    checkOneArg(args);
+    SchemeItem *item = args->car;
+    if (typeOf(item) == DOUBLE_TYPE) {
+        // every double this big is a whole number (and infinity and NaN aren't)
+        double value = item->d;
+        if (value - value != 0) {
+            return SCHEME_FALSE;
+        }
+        return makeBool(value >= 9007199254740992.0 || value <= -9007199254740992.0 || value == (double)(long)value);
+    }
+    return makeBool(isExactInteger(item));
+}
+
+// Primitive implementation of function zero?
+SchemeItem *primitiveIsZero(SchemeItem *args) {
+    checkOneArg(args);
+    return makeBool(numberCompare(args->car, makeFixnum(0)) == 0);
+}
+
+// Primitive implementation of function abs
+SchemeItem *primitiveAbs(SchemeItem *args) {
+    checkOneArg(args);
+    if (numberCompare(args->car, makeFixnum(0)) < 0) {
+        return numberSubtract(makeFixnum(0), args->car);
+    }
+    return args->car;
+}
+
+// Primitive implementation of function exact->inexact
+SchemeItem *primitiveExactToInexact(SchemeItem *args) {
+    checkOneArg(args);
+    return makeDouble(numberToDouble(args->car));
+}
+
+// Array entry points for the primitives above (see fixed in schemeitem.h). Each
+// does just what its list version does, with the same errors. The caller keeps
+// the array rooted, so whatever is read from it after an allocation is current.
+
+SchemeItem *fixedCar(SchemeItem **args, int count) {
+    if (count != 1 || typeOf(args[0]) != CONS_TYPE) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    return args[0]->car;
+}
+
+SchemeItem *fixedCdr(SchemeItem **args, int count) {
+    if (count != 1 || typeOf(args[0]) != CONS_TYPE) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    return args[0]->cdr;
+}
+
+SchemeItem *fixedNull(SchemeItem **args, int count) {
+    if (count != 1) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    return makeBool(args[0] == SCHEME_EMPTY);
+}
+
+SchemeItem *fixedEq(SchemeItem **args, int count) {
+    if (count != 2) {
+        printf("Evaluation error: too many args\n");
+        texit(1);
+    }
+    return makeBool(args[0] == args[1]);
+}
+
+SchemeItem *fixedEqual(SchemeItem **args, int count) {
+    if (count != 2) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    return makeBool(isEqual(args[0], args[1]));
+}
+
+SchemeItem *fixedCons(SchemeItem **args, int count) {
+    if (count != 2) {
         printf("Evaluation error\n");
         texit(1);
     }
-    SchemeItem *cons_item = makeEmpty();
-    cons_item->type = CONS_TYPE;
-    cons_item = cons(args->car, args->cdr->car);
+    return cons(args[0], args[1]);
+}
+
+// Like foldNumbers, for the arguments from start on
+SchemeItem *foldArray(SchemeItem *total, SchemeItem **args, int start, int count, SchemeItem *(*combine)(SchemeItem *, SchemeItem *)) {
+    for (int i = start; i < count; i++) {
+        total = combine(total, args[i]);
+    }
+    return total;
+}
+
+SchemeItem *fixedAdd(SchemeItem **args, int count) {
+    long total = 0;
+    int i = 0;
+    while (i < count && typeOf(args[i]) == INT_TYPE) {
+        total = total + fixnumValue(args[i]);
+        i++;
+        if (total > FIXNUM_MAX || total < FIXNUM_MIN) {
+            break;
+        }
+    }
+    if (i == count) {
+        return makeInteger(total);
+    }
+    return foldArray(makeInteger(total), args, i, count, numberAdd);
+}
+
+SchemeItem *fixedMultiply(SchemeItem **args, int count) {
+    return foldArray(makeFixnum(1), args, 0, count, numberMultiply);
+}
+
+SchemeItem *fixedSubtract(SchemeItem **args, int count) {
+    if (count == 0) {
+        printf("Evaluation error: - needs at least one argument\n");
+        texit(1);
+    }
+    if (count == 1) {
+        return numberSubtract(makeFixnum(0), args[0]);
+    }
+    return foldArray(args[0], args, 1, count, numberSubtract);
+}
+
+SchemeItem *fixedDivide(SchemeItem **args, int count) {
+    if (count == 0) {
+        printf("Evaluation error: / needs at least one argument\n");
+        texit(1);
+    }
+    if (count == 1) {
+        return numberDivide(makeFixnum(1), args[0]);
+    }
+    return foldArray(args[0], args, 1, count, numberDivide);
+}
+
+// Checks that an array entry point got exactly two arguments
+void checkTwoFixedArgs(int count) {
+    if (count != 2) {
+        printf("Evaluation error: expected two arguments\n");
+        texit(1);
+    }
+}
+
+SchemeItem *fixedQuotient(SchemeItem **args, int count) {
+    checkTwoFixedArgs(count);
+    return numberQuotient(args[0], args[1]);
+}
+
+SchemeItem *fixedRemainder(SchemeItem **args, int count) {
+    checkTwoFixedArgs(count);
+    return numberRemainder(args[0], args[1]);
+}
+
+SchemeItem *fixedModulo(SchemeItem **args, int count) {
+    checkTwoFixedArgs(count);
+    return numberModulo(args[0], args[1]);
+}
+
+// Like compareNumbers
+SchemeItem *compareArray(SchemeItem **args, int count, bool less, bool equal, bool greater) {
+    if (count < 2) {
+        printf("Evaluation error: comparison needs at least two arguments\n");
+        texit(1);
+    }
+    bool result = true;
+    for (int i = 0; i + 1 < count; i++) {
+        int order = numberCompare(args[i], args[i + 1]);
+        if (order == NUMBER_UNORDERED || (order < 0 && !less) || (order == 0 && !equal) || (order > 0 && !greater)) {
+            result = false;
+        }
+    }
+    return makeBool(result);
+}
+
+SchemeItem *fixedNumberEqual(SchemeItem **args, int count) {
+    return compareArray(args, count, false, true, false);
+}
+
+SchemeItem *fixedLessThan(SchemeItem **args, int count) {
+    return compareArray(args, count, true, false, false);
+}
+
+SchemeItem *fixedGreaterThan(SchemeItem **args, int count) {
+    return compareArray(args, count, false, false, true);
+}
 
-    return cons_item;
+SchemeItem *fixedLessOrEqual(SchemeItem **args, int count) {
+    return compareArray(args, count, true, true, false);
+}
+
+SchemeItem *fixedGreaterOrEqual(SchemeItem **args, int count) {
+    return compareArray(args, count, false, true, true);
+}
+
+SchemeItem *fixedIsZero(SchemeItem **args, int count) {
+    if (count != 1) {
+        printf("Evaluation error: expected one argument\n");
+        texit(1);
+    }
+    return makeBool(numberCompare(args[0], makeFixnum(0)) == 0);
+}
+
+// Primitive implementation of function cons
+//
+// Will check to see that exactly two arguments provided
+SchemeItem *primitiveCons(SchemeItem *args) {
+    if (length(args) != 2) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    return cons(args->car, args->cdr->car);
 }
 
 // Primitive implementation of function append
@@ -685,29 +1199,35 @@ SchemeItem *primitiveAppend(SchemeItem *args) {
         texit(1);
     }
 
-    if (args->car->type != CONS_TYPE && args->car->type != EMPTY_TYPE) {
+    if (typeOf(args->car) != CONS_TYPE && typeOf(args->car) != EMPTY_TYPE) {
         printf("Evaluation error\n");
         texit(1);
     }
-    SchemeItem *total_first = makeEmpty();
-
     SchemeItem *first  = args->car;
     SchemeItem *second = args->cdr->car;
 
-    if (first->type == EMPTY_TYPE) {
+    if (typeOf(first) == EMPTY_TYPE) {
         return second;
     }
 
     SchemeItem *result_head = NULL;
     SchemeItem *result_tail = NULL;
 
-     while (first->type == CONS_TYPE) {
-        SchemeItem *new_node = cons(first->car, makeEmpty());
+    size_t roots = gcSaveRoots();
+    GC_ROOT(first);
+    GC_ROOT(second);
+    GC_ROOT(result_head);
+    GC_ROOT(result_tail);
+
+     while (typeOf(first) == CONS_TYPE) {
+        SchemeItem *empty = makeEmpty();
+        SchemeItem *new_node = cons(first->car, empty);
 
         if (result_head == NULL) {
             result_head = new_node;
         } else {
             result_tail->cdr = new_node;
+            gcWriteBarrier(result_tail);
         }
         result_tail = new_node;
 
@@ -715,154 +1235,753 @@ SchemeItem *primitiveAppend(SchemeItem *args) {
     }
 
     result_tail->cdr = second;
+    gcWriteBarrier(result_tail);
 
+    gcRestoreRoots(roots);
     return result_head;
 }
 
-// Binds provided primitive function name to function in C
+// Checks that item is a vector, and returns it as one
+Vector *checkVector(SchemeItem *item) {
+    if (typeOf(item) != VECTOR_TYPE) {
+        printf("Evaluation error: not a vector\n");
+        texit(1);
+    }
+    return (Vector *)item;
+}
+
+// Checks that index is a valid index into vector, and returns it
+long checkIndex(Vector *vector, SchemeItem *index) {
+    if (typeOf(index) != INT_TYPE || fixnumValue(index) < 0 || fixnumValue(index) >= vector->length) {
+        printf("Evaluation error: vector index out of range\n");
+        texit(1);
+    }
+    return fixnumValue(index);
+}
+
+// Primitive implementation of function make-vector. Without a fill, every
+// element starts out as 0
+SchemeItem *primitiveMakeVector(SchemeItem *args) {
+    int arg_count = length(args);
+    if (arg_count != 1 && arg_count != 2) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    SchemeItem *size = args->car;
+    if (typeOf(size) != INT_TYPE || fixnumValue(size) < 0 || fixnumValue(size) > VECTOR_MAX_LENGTH) {
+        printf("Evaluation error: bad vector length\n");
+        texit(1);
+    }
+    return makeVector(fixnumValue(size), arg_count == 2 ? args->cdr->car : makeFixnum(0));
+}
+
+// Primitive implementation of function vector: a vector of its arguments
+SchemeItem *primitiveVector(SchemeItem *args) {
+    return listToVector(args);
+}
+
+// Primitive implementation of function vector?
+SchemeItem *primitiveIsVector(SchemeItem *args) {
+    checkOneArg(args);
+    return makeBool(typeOf(args->car) == VECTOR_TYPE);
+}
+
+// Primitive implementation of function vector-length
+SchemeItem *primitiveVectorLength(SchemeItem *args) {
+    checkOneArg(args);
+    return makeFixnum(checkVector(args->car)->length);
+}
+
+// Primitive implementation of function vector-ref
+SchemeItem *primitiveVectorRef(SchemeItem *args) {
+    checkTwoArgs(args);
+    Vector *vector = checkVector(args->car);
+    return vector->items[checkIndex(vector, args->cdr->car)];
+}
+
+// Primitive implementation of function vector-set!. Vector literals are constant
+SchemeItem *primitiveVectorSet(SchemeItem *args) {
+    if (length(args) != 3) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    Vector *vector = checkVector(args->car);
+    long index = checkIndex(vector, args->cdr->car);
+    if (vector->constant) {
+        printf("Evaluation error: vector-set! on a constant vector\n");
+        texit(1);
+    }
+    vector->items[index] = args->cdr->cdr->car;
+    gcWriteBarrier(vector);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function vector->list
+SchemeItem *primitiveVectorToList(SchemeItem *args) {
+    checkOneArg(args);
+    return vectorToList((SchemeItem *)checkVector(args->car));
+}
+
+// Primitive implementation of function list->vector
+SchemeItem *primitiveListToVector(SchemeItem *args) {
+    checkOneArg(args);
+    SchemeItem *current = args->car;
+    while (typeOf(current) == CONS_TYPE) {
+        current = current->cdr;
+    }
+    if (typeOf(current) != EMPTY_TYPE) {
+        printf("Evaluation error: not a list\n");
+        texit(1);
+    }
+    return listToVector(args->car);
+}
+
+// Checks that item is a string
+SchemeItem *checkString(SchemeItem *item) {
+    if (typeOf(item) != STR_TYPE) {
+        printf("Evaluation error: not a string\n");
+        texit(1);
+    }
+    return item;
+}
+
+// Primitive implementation of function string?
+SchemeItem *primitiveIsString(SchemeItem *args) {
+    checkOneArg(args);
+    return makeBool(typeOf(args->car) == STR_TYPE);
+}
+
+// Primitive implementation of function string-length
+SchemeItem *primitiveStringLength(SchemeItem *args) {
+    checkOneArg(args);
+    return makeFixnum(checkString(args->car)->length);
+}
+
+// Primitive implementation of function substring, whose end defaults to the end of
+// the string. The substring shares the original's text rather than copying it.
+SchemeItem *primitiveSubstring(SchemeItem *args) {
+    int arg_count = length(args);
+    if (arg_count != 2 && arg_count != 3) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    SchemeItem *string = checkString(args->car);
+    SchemeItem *start = args->cdr->car;
+    SchemeItem *end = arg_count == 3 ? args->cdr->cdr->car : makeFixnum(string->length);
+    if (typeOf(start) != INT_TYPE || typeOf(end) != INT_TYPE || fixnumValue(start) < 0
+        || fixnumValue(start) > fixnumValue(end) || fixnumValue(end) > string->length) {
+        printf("Evaluation error: substring index out of range\n");
+        texit(1);
+    }
+    return substring(string, fixnumValue(start), fixnumValue(end));
+}
+
+// Primitive implementation of function string-append
+SchemeItem *primitiveStringAppend(SchemeItem *args) {
+    return stringAppend(args);
+}
+
+// Compares each argument (all strings, at least two of them) with the next, and
+// returns whether every comparison came out as one of the orders allowed
+SchemeItem *compareStrings(SchemeItem *args, bool less, bool equal) {
+    if (length(args) < 2) {
+        printf("Evaluation error: expected at least two arguments\n");
+        texit(1);
+    }
+    bool result = true;
+    for (SchemeItem *current = args; typeOf(current->cdr) == CONS_TYPE; current = current->cdr) {
+        SchemeItem *left = checkString(current->car);
+        SchemeItem *right = checkString(current->cdr->car);
+        if (equal && !less) {
+            result = result && stringEqual(left, right);
+        } else {
+            int order = stringCompare(left, right);
+            result = result && ((order < 0 && less) || (order == 0 && equal));
+        }
+    }
+    return makeBool(result);
+}
+
+// Primitive implementation of function string=?
+SchemeItem *primitiveStringEqual(SchemeItem *args) {
+    return compareStrings(args, false, true);
+}
+
+// Primitive implementation of function string<?
+SchemeItem *primitiveStringLessThan(SchemeItem *args) {
+    return compareStrings(args, true, false);
+}
+
+// Primitive implementation of function string->symbol
+SchemeItem *primitiveStringToSymbol(SchemeItem *args) {
+    checkOneArg(args);
+    SchemeItem *string = checkString(args->car);
+    return internLength(stringChars(string), string->length);
+}
+
+// Primitive implementation of function symbol->string
+SchemeItem *primitiveSymbolToString(SchemeItem *args) {
+    checkOneArg(args);
+    if (typeOf(args->car) != SYMBOL_TYPE) {
+        printf("Evaluation error: not a symbol\n");
+        texit(1);
+    }
+    return makeString(args->car->s, strlen(args->car->s));
+}
+
+// Checks that item is a hash table
+SchemeItem *checkHashTable(SchemeItem *item) {
+    if (typeOf(item) != HASHTABLE_TYPE) {
+        printf("Evaluation error: not a hash table\n");
+        texit(1);
+    }
+    return item;
+}
+
+// Primitive implementation of function make-hash-table. Keys are compared with
+// equal?, unless eq? is passed in
+SchemeItem *primitiveMakeHashTable(SchemeItem *args) {
+    int arg_count = length(args);
+    if (arg_count == 0) {
+        return makeHashTable(true);
+    }
+    SchemeItem *test = args->car;
+    if (arg_count != 1 || typeOf(test) != PRIMITIVE_TYPE || (test->pf != primitiveEq && test->pf != primitiveEqual)) {
+        printf("Evaluation error: make-hash-table takes eq? or equal?\n");
+        texit(1);
+    }
+    return makeHashTable(test->pf == primitiveEqual);
+}
+
+// Primitive implementation of function hash-table?
+SchemeItem *primitiveIsHashTable(SchemeItem *args) {
+    checkOneArg(args);
+    return makeBool(typeOf(args->car) == HASHTABLE_TYPE);
+}
+
+// Primitive implementation of function hash-table-ref. If the key isn't there,
+// calls the optional third argument (a procedure of no arguments) instead
+SchemeItem *primitiveHashTableRef(SchemeItem *args) {
+    int arg_count = length(args);
+    if (arg_count != 2 && arg_count != 3) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
+    SchemeItem *value = hashTableRef(checkHashTable(args->car), args->cdr->car);
+    gcRestoreRoots(roots);
+
+    if (value != NULL) {
+        return value;
+    }
+    if (arg_count == 3) {
+        return callProcedure(args->cdr->cdr->car, makeEmpty());
+    }
+    printf("Evaluation error: key not found in hash table\n");
+    texit(1);
+    return NULL;
+}
+
+// Primitive implementation of function hash-table-ref/default
+SchemeItem *primitiveHashTableRefDefault(SchemeItem *args) {
+    if (length(args) != 3) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
+    SchemeItem *value = hashTableRef(checkHashTable(args->car), args->cdr->car);
+    gcRestoreRoots(roots);
+    return value != NULL ? value : args->cdr->cdr->car;
+}
+
+// Primitive implementation of function hash-table-contains?
+SchemeItem *primitiveHashTableContains(SchemeItem *args) {
+    checkTwoArgs(args);
+    return makeBool(hashTableRef(checkHashTable(args->car), args->cdr->car) != NULL);
+}
+
+// Primitive implementation of function hash-table-set!
+SchemeItem *primitiveHashTableSet(SchemeItem *args) {
+    if (length(args) != 3) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    hashTableSet(checkHashTable(args->car), args->cdr->car, args->cdr->cdr->car);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function hash-table-delete!
+SchemeItem *primitiveHashTableDelete(SchemeItem *args) {
+    checkTwoArgs(args);
+    hashTableDelete(checkHashTable(args->car), args->cdr->car);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function hash-table-count: the number of keys
+SchemeItem *primitiveHashTableCount(SchemeItem *args) {
+    checkOneArg(args);
+    return makeFixnum(hashTableCount(checkHashTable(args->car)));
+}
+
+// Primitive implementation of function hash-table-keys
+SchemeItem *primitiveHashTableKeys(SchemeItem *args) {
+    checkOneArg(args);
+    return hashTableList(checkHashTable(args->car), true, false);
+}
+
+// Primitive implementation of function hash-table-values
+SchemeItem *primitiveHashTableValues(SchemeItem *args) {
+    checkOneArg(args);
+    return hashTableList(checkHashTable(args->car), false, true);
+}
+
+// Primitive implementation of function hash-table->alist
+SchemeItem *primitiveHashTableToAlist(SchemeItem *args) {
+    checkOneArg(args);
+    return hashTableList(checkHashTable(args->car), true, true);
+}
+
+// Primitive implementation of function hash-table-walk: calls its second argument
+// with each key and value. It walks a list of the entries taken beforehand, so
+// the procedure may change the table.
+SchemeItem *primitiveHashTableWalk(SchemeItem *args) {
+    checkTwoArgs(args);
+    SchemeItem *function = args->cdr->car;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(function);
+
+    SchemeItem *entries = hashTableList(checkHashTable(args->car), true, true);
+    GC_ROOT(entries);
+    SchemeItem *call_args = NULL;
+    GC_ROOT(call_args);
+    while (typeOf(entries) == CONS_TYPE) {
+        call_args = cons(entries->car->cdr, makeEmpty());
+        call_args = cons(entries->car->car, call_args);
+        callProcedure(function, call_args);
+        entries = entries->cdr;
+    }
+
+    gcRestoreRoots(roots);
+    return SCHEME_VOID;
+}
+
+// Helper for the output primitives, which take an optional port after count
+// other arguments. Returns the port, or the current output port if there isn't one
+Port *outputPort(SchemeItem *args, int count) {
+    int arg_count = length(args);
+    if (arg_count != count && arg_count != count + 1) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+    if (arg_count == count) {
+        return currentOutput();
+    }
+
+    for (int i = 0; i < count; i++) {
+        args = args->cdr;
+    }
+    if (typeOf(args->car) != PORT_TYPE) {
+        printf("Evaluation error: not a port\n");
+        texit(1);
+    }
+    return args->car->ptr;
+}
+
+// Primitive implementation of function display: writes a value, with strings
+// written without their quotes
+SchemeItem *primitiveDisplay(SchemeItem *args) {
+    portWriteItem(outputPort(args, 1), args->car, true);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function write: writes a value the way results are printed
+SchemeItem *primitiveWrite(SchemeItem *args) {
+    portWriteItem(outputPort(args, 1), args->car, false);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function newline
+SchemeItem *primitiveNewline(SchemeItem *args) {
+    portWrite(outputPort(args, 0), "\n", 1);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function flush-output: hands anything buffered in the
+// port to the operating system
+SchemeItem *primitiveFlushOutput(SchemeItem *args) {
+    flushPort(outputPort(args, 0));
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function open-output-file
 //
-// Used to add primitive functions to the home frame (top level) bindings
-void bind(char *name, SchemeItem *(*function)(SchemeItem *), Frame *frame) {
-    SchemeItem *name_object = makeEmpty();
-    name_object->type = SYMBOL_TYPE;
-    name_object->s = name;
+// Creates (or empties) the file named by its one string argument, and returns a port
+// writing to it
+SchemeItem *primitiveOpenOutputFile(SchemeItem *args) {
+    if (length(args) != 1 || typeOf(args->car) != STR_TYPE) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
 
-    SchemeItem *pointer = makeEmpty();
-    pointer->type = PRIMITIVE_TYPE;
+    char *path = stringToC(args->car);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Evaluation error: could not open %s\n", path);
+        texit(1);
+    }
+
+    SchemeItem *port_item = makeItem(PORT_TYPE);
+    port_item->ptr = makePort(fd);
+    return port_item;
+}
+
+// Primitive implementation of function close-output-port: flushes the port, and
+// closes its file
+SchemeItem *primitiveCloseOutputPort(SchemeItem *args) {
+    if (length(args) != 1 || typeOf(args->car) != PORT_TYPE) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    closePort(args->car->ptr);
+    return SCHEME_VOID;
+}
+
+// Primitive implementation of function with-output-to-string
+//
+// Calls its argument (a procedure with no arguments) with the current output port set
+// to a string port, and returns everything written to it as a string
+SchemeItem *primitiveWithOutputToString(SchemeItem *args) {
+    if (length(args) != 1) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+
+    Port *saved = currentOutput();
+    Port *port = makePort(-1);
+    setCurrentOutput(port);
+    callProcedure(args->car, makeEmpty());
+    setCurrentOutput(saved);
+
+    SchemeItem *string = makeString(port->buffer, port->length);
+    closePort(port);
+    return string;
+}
+
+
+// Binds provided primitive function name to function in C, for a primitive with
+// no side effects, which the analyzer may call on constant arguments that canFold
+// accepts (see analyzer.h)
+//
+// Used to add primitive functions to the global bindings
+void bindFoldable(char *name, SchemeItem *(*function)(SchemeItem *), bool (*canFold)(SchemeItem *)) {
+    SchemeItem *name_object = intern(name);
+
+    SchemeItem *pointer = makeItem(PRIMITIVE_TYPE);
     pointer->pf = function;
+    pointer->canFold = canFold;
+    pointer->fixed = NULL;
 
+    addBinding(name_object, pointer);
+}
 
-    SchemeItem *pair = cons(name_object, pointer);
+// Binds a primitive that is never folded
+void bind(char *name, SchemeItem *(*function)(SchemeItem *)) {
+    bindFoldable(name, function, NULL);
+}
 
-    frame->bindings = cons(pair, frame->bindings);
+// Gives an already bound primitive its array entry point (see fixed in schemeitem.h)
+void bindFixed(char *name, SchemeItem *(*fixed)(SchemeItem **, int)) {
+    findGlobalBinding(intern(name))->cdr->fixed = fixed;
 }
 
 
 
-// Evaluates a SchemeItem in the given frame
+// Helper functions for the special forms, indexed by the form tag on their keyword
+// (lambda has none, since the analysis pass turns it into a LAMBDA_TYPE node)
+SchemeItem *(*special_forms[SPECIAL_FORM_COUNT])(SchemeItem *args, Frame **frame, bool *tail) = {
+    [IF_FORM] = evalIf,
+    [LET_FORM] = evalLet,
+    [QUOTE_FORM] = evalQuote,
+    [DEFINE_FORM] = evalDefine,
+    [LETREC_FORM] = evalLetRec,
+    [SET_FORM] = evalSet,
+    [BEGIN_FORM] = evalBegin,
+    [COND_FORM] = evalCond,
+    [AND_FORM] = evalAnd,
+    [OR_FORM] = evalOr,
+};
+
+// Tags the symbol for a special form keyword, so that eval dispatches on it
+void tagSpecialForm(char *name, specialForm form) {
+    intern(name)->form = form;
+}
+
+// Evaluates an analyzed SchemeItem in the given frame
 //
 // Will just return atoms
 //
-// Will lookup symbols using the findVariableValue helper function
+// Will lookup variables using the findVariableValue helper function
+//
+// Lists whose first item is a special form keyword go to that form's helper function
+// through the special_forms table. Everything else is a procedure call.
 //
-// Currently only handles if and let statement
+// Expressions in tail position (see the special form helpers) and closure bodies don't
+// recurse: eval loops around with the new expression and frame instead, so a tail call
+// doesn't use any C stack
 SchemeItem *eval(SchemeItem *tree, Frame *frame) {
-    switch (tree->type)  {
-        case INT_TYPE: {
-            return tree;
-        }
-        case BOOL_TYPE: {
-            return tree;
-        }
-        case DOUBLE_TYPE: {
-            return tree;
-        }
-        case STR_TYPE: {
-            return tree;
-        }
-        case SYMBOL_TYPE: {
-            // the value of our symbol is dependent on the frame we are in
-            // thus, use a helper function in orde to check based on frame
-            return findVariableValue(frame, tree->s);
-        }
-        case CONS_TYPE: {
-            SchemeItem *first = car(tree);
-            SchemeItem *args = cdr(tree);
-            if (first->type == SYMBOL_TYPE) {
-                if (strcmp(first->s,"if") == 0) {
-                    SchemeItem *result = evalIf(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "let") == 0) {
-                    SchemeItem *result = evalLet(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "quote") == 0) {
-                    SchemeItem *result = evalQuote(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "define") == 0) {
-                    SchemeItem *result = evalDefine(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "lambda") == 0) {
-                    SchemeItem *result = evalLambda(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "letrec") == 0) {
-                    SchemeItem *result = evalLetRec(args, frame);
-                    return result;
-                } else if (strcmp(first->s, "set!") == 0) {
-                    SchemeItem *result = evalSet(args, frame);
-                    return result;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(tree);
+    GC_ROOT(frame);
+    size_t loop_roots = gcSaveRoots();
+    bool entered = false; // whether this call is on the profiler's stack
+
+    SchemeItem *result = NULL;
+    while (result == NULL) {
+        STAT(statsEval(typeOf(tree)));
+        switch (typeOf(tree))  {
+            case INT_TYPE:
+            case BIGNUM_TYPE:
+            case VECTOR_TYPE:
+            case BOOL_TYPE:
+            case DOUBLE_TYPE:
+            case STR_TYPE: {
+                result = tree;
+                break;
+            }
+            case LOCAL_TYPE:
+            case BOXED_TYPE:
+            case GLOBAL_TYPE: {
+                // the value of our variable is dependent on the frame we are in
+                // thus, use a helper function in orde to check based on frame
+                result = findVariableValue(frame, tree);
+                break;
+            }
+            case LAMBDA_TYPE: {
+                result = evalLambda(tree, frame);
+                break;
+            }
+            case MAKEBOX_TYPE: {
+                boxSlot(frame, tree->index);
+                result = SCHEME_VOID;
+                break;
+            }
+            case FOLDED_TYPE: {
+                // the folded value, unless a primitive has been redefined since
+                if (tree->redefinitions == primitive_redefinitions) {
+                    result = tree->folded;
                 } else {
-                    // user-defined operator: evaluate operator and args, then apply
-                    SchemeItem *evaluated_operator = eval(first, frame);
-
-                    SchemeItem *evaluated_args = makeEmpty();
-                    SchemeItem *current = args;
-                    while (current->type == CONS_TYPE) {
-                        SchemeItem *evaluated_argument = eval(current->car, frame);
-                        evaluated_args = cons(evaluated_argument, evaluated_args);
-                        current = current->cdr;
+                    tree = tree->original;
+                }
+                break;
+            }
+            case CONS_TYPE: {
+                SchemeItem *first = car(tree);
+                SchemeItem *args = cdr(tree);
+                if (typeOf(first) == SYMBOL_TYPE && first->form != NOT_SPECIAL) {
+                    STAT(statsEvalForm(first->form));
+                    bool tail = false;
+                    SchemeItem *value = special_forms[first->form](args, &frame, &tail);
+                    if (tail) {
+                        tree = value;
+                    } else {
+                        result = value;
+                    }
+                    break;
+                }
+
+                // procedure call: evaluate operator and args, then apply
+                // the operator can be any expression, ie. ((lambda () ...))
+                GC_ROOT(args);
+
+                SchemeItem *evaluated_operator = eval(first, frame);
+                GC_ROOT(evaluated_operator);
+
+                if (typeOf(evaluated_operator) == PRIMITIVE_TYPE && evaluated_operator->fixed != NULL) {
+                    result = callFixed(evaluated_operator, args, frame);
+                    if (result != NULL) {
+                        gcRestoreRoots(loop_roots);
+                        break;
                     }
-                    evaluated_args = reverse(evaluated_args);
-                    return apply(evaluated_operator, evaluated_args);
                 }
+
+                SchemeItem *evaluated_args = makeEmpty();
+                SchemeItem *current = args;
+                GC_ROOT(evaluated_args);
+                GC_ROOT(current);
+                while (typeOf(current) == CONS_TYPE) {
+                    SchemeItem *evaluated_argument = eval(current->car, frame);
+                    evaluated_args = cons(evaluated_argument, evaluated_args);
+                    current = current->cdr;
+                }
+                evaluated_args = reverse(evaluated_args);
+
+                if (typeOf(evaluated_operator) == CLOSURE_TYPE) {
+                    // carry on with the body in the new frame, the last expression in tail position
+                    STAT(statsApply(true));
+                    frame = bindArguments(evaluated_operator, evaluated_args);
+                    if (entered) {
+                        profileReplace(evaluated_operator);
+                    } else {
+                        profileEnter(evaluated_operator);
+                        entered = true;
+                    }
+                    tree = evalToTail(evaluated_operator->lambda->body, frame);
+                } else {
+                    result = apply(evaluated_operator, evaluated_args);
+                }
+                gcRestoreRoots(loop_roots);
+                break;
             }
-            // we have a cons type, will two sets of parenthesis. ie, car is not a symbol, it is another list
-            // we have to include this again for double parenthesis ((lambda () ...))
-            // not sure if this is a good practice, should maybe just make function in the future
-            SchemeItem *evaluated_operator = eval(first, frame);
-
-            SchemeItem *evaluated_args = makeEmpty();
-            SchemeItem *current = args;
-            while (current->type == CONS_TYPE) {
-                SchemeItem *evaluated_argument = eval(current->car, frame);
-                evaluated_args = cons(evaluated_argument, evaluated_args);
-                current = current->cdr;
+            default: {
+                printf("Evaluation error: SchemeItem doesn't have a type\n");
+                texit(1);
             }
-            evaluated_args = reverse(evaluated_args);
-            return apply(evaluated_operator, evaluated_args);
-        }
-        case EMPTY_TYPE: {
-            printf("Evaluation error: cannot evaluate empty list\n");
-            texit(1);
-        }
-        default: {
-            printf("Evaluation error: SchemeItem doesn't have a type\n");
-            texit(1);
         }
     }
-    // to compile
-    return NULL;
+
+    if (entered) {
+        profileLeave();
+    }
+    gcRestoreRoots(roots);
+    return result;
 }
 
-// Main function that is called to interpret provided parse tree
+// Main function that is called to interpret the program on stdin
 //
-// First creates a home frame with a null parent frame
+// First binds the primitives as globals
 //
-// Then evaluates each s-expression, before printing it using the parser.c printItem funciton.
+// Then reads, analyzes and evaluates each top-level s-expression in turn, before the
+// next one is read (so output starts right away, and errors are reported in order),
+// printing it using the parser.c printItem funciton. With use_vm, each
+// one is compiled to bytecode and run on the VM instead of being evaluated by eval.
 //
 // Finally, exits the program to clear memory using texit
-void interpret(SchemeItem *tree) {
-    Frame *home_frame = makeFrame(NULL);
-
-    // Then, bind primitive functions
-    bind("car", primitiveCar, home_frame);
-    bind("cdr", primitiveCdr, home_frame);
-    bind("+", primitiveAdd, home_frame);
-    bind("null?", primitiveNull, home_frame);
-    bind("cons", primitiveCons, home_frame);
-    bind("append", primitiveAppend, home_frame);
-    bind("equal?", primitiveEqual, home_frame);
-    bind("<", primitiveLessThan, home_frame);
-
-    SchemeItem *line_reader = tree;
-    while (line_reader->type == CONS_TYPE) {
-        SchemeItem *evaluated = eval(line_reader->car, home_frame);
-        if (evaluated->type != VOID_TYPE) {
+void interpret(bool use_vm) {
+    size_t roots = gcSaveRoots();
+    initPorts();
+
+    global_bindings = makeHashTable(false);
+    GC_ROOT(global_bindings);
+
+    tagSpecialForm("if", IF_FORM);
+    tagSpecialForm("let", LET_FORM);
+    tagSpecialForm("quote", QUOTE_FORM);
+    tagSpecialForm("define", DEFINE_FORM);
+    tagSpecialForm("lambda", LAMBDA_FORM);
+    tagSpecialForm("letrec", LETREC_FORM);
+    tagSpecialForm("set!", SET_FORM);
+    tagSpecialForm("begin", BEGIN_FORM);
+    tagSpecialForm("cond", COND_FORM);
+    tagSpecialForm("and", AND_FORM);
+    tagSpecialForm("or", OR_FORM);
+
+    // Then, bind primitive functions (the foldable ones are pure, see bindFoldable)
+    bindFoldable("car", primitiveCar, canFoldPair);
+    bindFoldable("cdr", primitiveCdr, canFoldPair);
+    bindFoldable("+", primitiveAdd, canFoldArithmetic);
+    bindFoldable("null?", primitiveNull, canFoldOneArg);
+    bind("cons", primitiveCons);
+    bind("append", primitiveAppend);
+    bindFoldable("equal?", primitiveEqual, canFoldTwoArgs);
+    bindFoldable("eq?", primitiveEq, canFoldTwoArgs);
+    bindFoldable("-", primitiveSubtract, canFoldSubtract);
+    bindFoldable("*", primitiveMultiply, canFoldArithmetic);
+    bindFoldable("/", primitiveDivide, canFoldDivide);
+    bindFoldable("quotient", primitiveQuotient, canFoldIntegerDivision);
+    bindFoldable("remainder", primitiveRemainder, canFoldIntegerDivision);
+    bindFoldable("modulo", primitiveModulo, canFoldIntegerDivision);
+    bindFoldable("=", primitiveNumberEqual, canFoldComparison);
+    bindFoldable("<", primitiveLessThan, canFoldComparison);
+    bindFoldable(">", primitiveGreaterThan, canFoldComparison);
+    bindFoldable("<=", primitiveLessOrEqual, canFoldComparison);
+    bindFoldable(">=", primitiveGreaterOrEqual, canFoldComparison);
+    bindFoldable("number?", primitiveIsNumber, canFoldOneArg);
+    bindFoldable("integer?", primitiveIsInteger, canFoldOneArg);
+    bindFoldable("zero?", primitiveIsZero, canFoldNumber);
+    bindFoldable("abs", primitiveAbs, canFoldNumber);
+    bindFoldable("exact->inexact", primitiveExactToInexact, canFoldNumber);
+    bind("make-vector", primitiveMakeVector);
+    bind("vector", primitiveVector);
+    bind("vector?", primitiveIsVector);
+    bind("vector-length", primitiveVectorLength);
+    bind("vector-ref", primitiveVectorRef);
+    bind("vector-set!", primitiveVectorSet);
+    bind("vector->list", primitiveVectorToList);
+    bind("list->vector", primitiveListToVector);
+    bind("string?", primitiveIsString);
+    bind("string-length", primitiveStringLength);
+    bind("substring", primitiveSubstring);
+    bind("string-append", primitiveStringAppend);
+    bind("string=?", primitiveStringEqual);
+    bind("string<?", primitiveStringLessThan);
+    bind("string->symbol", primitiveStringToSymbol);
+    bind("symbol->string", primitiveSymbolToString);
+    bind("make-hash-table", primitiveMakeHashTable);
+    bind("hash-table?", primitiveIsHashTable);
+    bind("hash-table-ref", primitiveHashTableRef);
+    bind("hash-table-ref/default", primitiveHashTableRefDefault);
+    bind("hash-table-contains?", primitiveHashTableContains);
+    bind("hash-table-set!", primitiveHashTableSet);
+    bind("hash-table-delete!", primitiveHashTableDelete);
+    bind("hash-table-count", primitiveHashTableCount);
+    bind("hash-table-keys", primitiveHashTableKeys);
+    bind("hash-table-values", primitiveHashTableValues);
+    bind("hash-table->alist", primitiveHashTableToAlist);
+    bind("hash-table-walk", primitiveHashTableWalk);
+    bind("display", primitiveDisplay);
+    bind("write", primitiveWrite);
+    bind("newline", primitiveNewline);
+    bind("flush-output", primitiveFlushOutput);
+    bind("open-output-file", primitiveOpenOutputFile);
+    bind("close-output-port", primitiveCloseOutputPort);
+    bind("with-output-to-string", primitiveWithOutputToString);
+
+    // and the array entry points of the ones calls can skip the list for
+    bindFixed("car", fixedCar);
+    bindFixed("cdr", fixedCdr);
+    bindFixed("cons", fixedCons);
+    bindFixed("null?", fixedNull);
+    bindFixed("eq?", fixedEq);
+    bindFixed("equal?", fixedEqual);
+    bindFixed("+", fixedAdd);
+    bindFixed("-", fixedSubtract);
+    bindFixed("*", fixedMultiply);
+    bindFixed("/", fixedDivide);
+    bindFixed("quotient", fixedQuotient);
+    bindFixed("remainder", fixedRemainder);
+    bindFixed("modulo", fixedModulo);
+    bindFixed("=", fixedNumberEqual);
+    bindFixed("<", fixedLessThan);
+    bindFixed(">", fixedGreaterThan);
+    bindFixed("<=", fixedLessOrEqual);
+    bindFixed(">=", fixedGreaterOrEqual);
+    bindFixed("zero?", fixedIsZero);
+
+    // results are only written out as they come when someone is watching
+    bool interactive = isatty(STDOUT_FILENO);
+
+    SchemeItem *form = readDatum();
+    while (form != NULL) {
+        SchemeItem *analyzed = analyze(form);
+        SchemeItem *evaluated;
+        if (use_vm) {
+            evaluated = vmRun(compile(analyzed));
+        } else {
+            evaluated = eval(analyzed, NULL);
+        }
+        if (evaluated != SCHEME_VOID) {
             printItem(evaluated);
-            printf("\n");
+            portWrite(currentOutput(), "\n", 1);
+        }
+        if (interactive) {
+            flushPort(currentOutput());
         }
 
-        line_reader = line_reader->cdr;
+        form = readDatum();
     }
 
+    gcRestoreRoots(roots);
     texit(0);
-}
\ No newline at end of file
+}
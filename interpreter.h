@@ -1,10 +1,29 @@
 #ifndef _INTERPRETER
 #define _INTERPRETER
 
+#include <stdbool.h>
 #include "schemeitem.h"
 
-void interpret(SchemeItem *tree);
+// Reads and interprets the top-level forms on stdin one at a time, each as soon
+// as it has been read, with the bytecode VM if use_vm is set and the
+// tree-walking eval otherwise.
+void interpret(bool use_vm);
 SchemeItem *eval(SchemeItem *tree, Frame *frame);
 
-#endif
+// Shared with the VM
+Frame *makeFrame(Frame *parent, int size);
+Frame *frameAt(Frame *frame, int depth);
+void boxSlot(Frame *frame, int index);
+void defineSlot(Frame *frame, int index, SchemeItem *value);
+SchemeItem *makeClosure(SchemeItem *lambda, Frame *captured);
+SchemeItem *findGlobalBinding(SchemeItem *symbol);
+void setGlobal(SchemeItem *pair, SchemeItem *value);
+size_t primitiveRedefinitions();
+void addBinding(SchemeItem *name, SchemeItem *value);
+
+// Returns whether an evaluated value counts as false. Everything but #f is true
+static inline bool isFalse(SchemeItem *item) {
+    return item == SCHEME_FALSE;
+}
 
+#endif
@@ -2,21 +2,35 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "schemeitem.h"
+#include "linkedlist.h"
 #include "talloc.h"
+#include "gc.h"
+#include "number.h"
+#include "schemestring.h"
 #include <assert.h>
 #include <string.h>
 
-// Creates a scheme item with the type EMPTY_TPE
+// Returns the empty list. It is an immediate (see schemeitem.h), so nothing is allocated
 SchemeItem *makeEmpty() {
-    SchemeItem *newItem = talloc(sizeof(SchemeItem));
-    newItem->type = EMPTY_TYPE;
+    return SCHEME_EMPTY;
+};
+
+// Creates a scheme item of the given type, with every other field zeroed
+// The item lives in the garbage collected heap, so this may run a collection
+SchemeItem *makeItem(itemType type) {
+    SchemeItem *newItem = gcAlloc(GC_ITEM, sizeof(SchemeItem));
+    newItem->type = type;
     return newItem;
 };
 
 // Create a scheme item with the type CONS_TYPE and the provided car and cdr values of that new node.
 SchemeItem *cons(SchemeItem *newCar, SchemeItem *newCdr) {
-    SchemeItem *newItem = makeEmpty();
-    newItem->type = CONS_TYPE;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(newCar);
+    GC_ROOT(newCdr);
+
+    SchemeItem *newItem = makeItem(CONS_TYPE);
+    gcRestoreRoots(roots);
 
     newItem->car = newCar;
     newItem->cdr = newCdr;
@@ -24,6 +38,53 @@ SchemeItem *cons(SchemeItem *newCar, SchemeItem *newCdr) {
     return newItem;
 };
 
+// Creates a vector with length elements, all of them fill. Like makeItem, this may
+// run a collection
+SchemeItem *makeVector(long length, SchemeItem *fill) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(fill);
+    Vector *vector = gcAlloc(GC_ITEM, sizeof(Vector) + length * sizeof(SchemeItem *));
+    gcRestoreRoots(roots);
+
+    vector->type = VECTOR_TYPE;
+    vector->length = length;
+    for (long i = 0; i < length; i++) {
+        vector->items[i] = fill;
+    }
+    return (SchemeItem *)vector;
+}
+
+// Creates a vector from the elements of list. The list is measured first, so the
+// vector is allocated just once
+SchemeItem *listToVector(SchemeItem *list) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(list);
+    Vector *vector = (Vector *)makeVector(length(list), makeEmpty());
+    gcRestoreRoots(roots);
+
+    SchemeItem *current = list;
+    for (long i = 0; i < vector->length; i++) {
+        vector->items[i] = current->car;
+        current = current->cdr;
+    }
+    return (SchemeItem *)vector;
+}
+
+// Creates a list from the elements of vector, consing from the last one back
+SchemeItem *vectorToList(SchemeItem *vector) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(vector);
+
+    SchemeItem *list = makeEmpty();
+    GC_ROOT(list);
+    for (long i = ((Vector *)vector)->length - 1; i >= 0; i--) {
+        list = cons(((Vector *)vector)->items[i], list);
+    }
+
+    gcRestoreRoots(roots);
+    return list;
+}
+
 // Print out the contents of the provided linked list (list).
 //
 // ex. [1.000, 2, hi, 7]
@@ -32,17 +93,23 @@ void display(SchemeItem *list) {
 
     SchemeItem *current = list;
 
-    while (current != NULL && current->type == CONS_TYPE) {
+    while (current != NULL && typeOf(current) == CONS_TYPE) {
         SchemeItem *the_car = current->car;
-        switch (the_car->type) {
+        switch (typeOf(the_car)) {
             case INT_TYPE:
-                printf("%i", the_car->i);
+                printf("%ld", fixnumValue(the_car));
                 break;
+            case BIGNUM_TYPE: {
+                char *digits = bignumToString(the_car);
+                printf("%s", digits);
+                free(digits);
+                break;
+            }
             case DOUBLE_TYPE:
                 printf("%f", the_car->d);
                 break;
             case STR_TYPE:
-                printf("%s", the_car->s);
+                printf("\"%.*s\"", (int)the_car->length, stringChars(the_car));
                 break;
             case CONS_TYPE:
                 display(the_car);
@@ -76,9 +143,36 @@ void display(SchemeItem *list) {
                 break;
             case UNSPECIFIED_TYPE:
                 break;
+            case LOCAL_TYPE:
+                break;
+            case BOXED_TYPE:
+                break;
+            case GLOBAL_TYPE:
+                break;
+            case LAMBDA_TYPE:
+                break;
+            case MAKEBOX_TYPE:
+                break;
+            case FOLDED_TYPE:
+                break;
+            case CODE_TYPE:
+                break;
+            case PORT_TYPE:
+                break;
+            case VECTOR_TYPE:
+                printf("#<vector>");
+                break;
+            case OPENVECTOR_TYPE:
+                printf("#(");
+                break;
+            case HASHTABLE_TYPE:
+                printf("#<hash-table>");
+                break;
+            case BOX_TYPE:
+                break;
         }
 
-        if (current->cdr->type != EMPTY_TYPE){
+        if (typeOf(current->cdr) != EMPTY_TYPE){
             printf(", "); // add a comma between them
         }
 
@@ -91,11 +185,14 @@ void display(SchemeItem *list) {
 // Copies elements to a new list while reversing their pointer order 
 // thus reversing the order of the given list, without copying any data
 SchemeItem *reverse(SchemeItem *list) {
-    SchemeItem *reversed = makeEmpty();
-
     SchemeItem *current = list;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(current);
+
+    SchemeItem *reversed = makeEmpty();
+    GC_ROOT(reversed);
 
-    while (current != NULL && current->type == CONS_TYPE) {
+    while (current != NULL && typeOf(current) == CONS_TYPE) {
         SchemeItem *copied = current->car;
 
         reversed = cons(copied, reversed); //add it on to the overall
@@ -103,18 +200,19 @@ SchemeItem *reverse(SchemeItem *list) {
         current = current->cdr;
     }
 
+    gcRestoreRoots(roots);
     return reversed;
 };
 
 // Returns a pointer to the car value of a list. First checks to make sure that list is a valid CONS cell.
 SchemeItem *car(SchemeItem *list) {
-    assert(list != NULL && list->type == CONS_TYPE);
+    assert(list != NULL && typeOf(list) == CONS_TYPE);
     return list->car;
 };
 
 // Returns a pointer to the cdr value of a list. First checks to make sure that list is a valid CONS cell.
 SchemeItem *cdr(SchemeItem *list) {
-    assert(list != NULL && list->type == CONS_TYPE);
+    assert(list != NULL && typeOf(list) == CONS_TYPE);
     return list->cdr;
 };
 
@@ -122,7 +220,7 @@ SchemeItem *cdr(SchemeItem *list) {
 bool isEmpty(SchemeItem *item) {
     assert(item != NULL);
 
-    if (item->type == EMPTY_TYPE) {
+    if (typeOf(item) == EMPTY_TYPE) {
         return true;
     } else { 
         return false;
@@ -139,7 +237,7 @@ int length(SchemeItem *item) {
     int length = 0;
     SchemeItem *current = item;
 
-    while (current != NULL && current->type != EMPTY_TYPE && current->type == CONS_TYPE) {
+    while (current != NULL && typeOf(current) != EMPTY_TYPE && typeOf(current) == CONS_TYPE) {
         length++;
         current = current->cdr;
     }
@@ -4,12 +4,27 @@
 #ifndef _LINKEDLIST
 #define _LINKEDLIST
 
-// Create a new EMPTY_TYPE value node.
+// Returns the empty list (an immediate, so this never allocates).
 SchemeItem *makeEmpty();
 
+// Create a new heap item of the given type. Every other field is zeroed.
+SchemeItem *makeItem(itemType type);
+
 // Create a new CONS_TYPE value node.
 SchemeItem *cons(SchemeItem *newCar, SchemeItem *newCdr);
 
+// Vectors can't be longer than this, so their size always fits the collector's header
+#define VECTOR_MAX_LENGTH (1L << 28)
+
+// Create a new vector of the given length, with every element set to fill.
+SchemeItem *makeVector(long length, SchemeItem *fill);
+
+// Create a new vector holding the elements of a proper list, in order.
+SchemeItem *listToVector(SchemeItem *list);
+
+// Create a new list holding the elements of a vector, in order.
+SchemeItem *vectorToList(SchemeItem *vector);
+
 // Display the contents of the linked list to the screen in some kind of
 // readable format
 void display(SchemeItem *list);
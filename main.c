@@ -1,16 +1,116 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "tokenizer.h"
 #include "schemeitem.h"
 #include "linkedlist.h"
 #include "parser.h"
 #include "talloc.h"
 #include "interpreter.h"
+#include "gc.h"
+#include "stats.h"
+#include "profile.h"
 
-int main() {
+// Returns the peak resident set size of this process in KB, or 0 if it can't be
+// found. This is read from /proc, since getrusage also counts whatever the parent
+// had before the exec.
+long peakRSS() {
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status == NULL) {
+        return 0;
+    }
+    char line[256];
+    long kilobytes = 0;
+    while (fgets(line, sizeof(line), status) != NULL) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            kilobytes = strtol(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return kilobytes;
+}
+
+// Prints the collector's counters (see --gc-stats). Runs at exit, after the heap
+// has been freed, so it only reports totals.
+void printGCStats() {
+    fprintf(stderr, "gc-stats: allocations=%zu allocated_bytes=%zu collections=%zu minor_collections=%zu "
+            "promoted_bytes=%zu peak_heap_bytes=%zu max_rss_kb=%ld\n",
+            gcAllocations(), gcAllocatedBytes(), gcCollections(), gcMinorCollections(),
+            gcPromotedBytes(), gcPeakHeapBytes(), peakRSS());
+}
+
+// Options:
+//   --heap-initial=BYTES  collect once the heap holds this many bytes (default 8 MB)
+//   --heap-growth=FACTOR  after a collection, let the heap grow to FACTOR times
+//                         the surviving bytes before collecting again (default 2)
+//   --nursery-size=BYTES  size of the nursery new objects are allocated in (default 256 KB)
+//   --gc-stress           collect before every allocation (for debugging)
+//   --vm                  compile to bytecode and run it on the VM, instead of walking the tree
+//   --gc-stats            print the collector's counters to stderr on exit, as key=value pairs
+//   --stats               print counts of evals, calls, frames, lookups and tallocs to stderr
+//                         on exit (only in a build with the counters, see just build-stats)
+//   --profile[=FILE]      sample which Scheme procedures are running, and print flat, inclusive
+//                         and caller profiles to stderr on exit. With a FILE, also write the
+//                         samples there as folded stacks for flamegraph.pl.
+// The program is read from the file given after the options, or from stdin.
+int main(int argc, char *argv[]) {
+    size_t heap_initial = 8 * 1024 * 1024;
+    double heap_growth = 2.0;
+    size_t nursery_size = 256 * 1024;
+    bool gc_stress = false;
+    bool use_vm = false;
+    bool gc_stats = false;
+    bool stats = false;
+    bool profile = false;
+    char *profile_path = NULL;
+    char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--heap-initial=", 15) == 0) {
+            heap_initial = strtoull(argv[i] + 15, NULL, 10);
+        } else if (strncmp(argv[i], "--heap-growth=", 14) == 0) {
+            heap_growth = strtod(argv[i] + 14, NULL);
+        } else if (strncmp(argv[i], "--nursery-size=", 15) == 0) {
+            nursery_size = strtoull(argv[i] + 15, NULL, 10);
+        } else if (strcmp(argv[i], "--gc-stress") == 0) {
+            gc_stress = true;
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            use_vm = true;
+        } else if (strcmp(argv[i], "--gc-stats") == 0) {
+            gc_stats = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            profile = true;
+            profile_path = argv[i] + 10;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--heap-initial=BYTES] [--heap-growth=FACTOR] [--nursery-size=BYTES] [--gc-stress] [--vm] [--gc-stats] [--stats] [--profile[=FILE]] [file.scm]\n", argv[0]);
+            return 1;
+        }
+    }
+    gcConfigure(heap_initial, heap_growth, nursery_size, gc_stress);
+    if (gc_stats) {
+        atexit(printGCStats);
+    }
+    if (stats) {
+#ifdef STATS
+        atexit(printStats);
+#else
+        fprintf(stderr, "%s: --stats needs a build with the counters compiled in (just build-stats)\n", argv[0]);
+        return 1;
+#endif
+    }
+    openInput(path);
+    if (profile) {
+        profileStart(profile_path);
+    }
 
-    SchemeItem *list = tokenize();
-    SchemeItem *tree = parse(list);
-    interpret(tree);
+    interpret(use_vm);
 
     tfree();
     return 0;
@@ -0,0 +1,675 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "gc.h"
+#include "number.h"
+
+// A bignum is a sign and a magnitude in base 2^32 digits, least significant
+// first. It is allocated as raw bytes (there are no pointers in it), but starts
+// with its type like any other item, so typeOf works on it. length never counts
+// leading zero digits, and a bignum is never 0 or small enough to be a fixnum.
+typedef struct Bignum {
+    itemType type;
+    bool negative;
+    int length;
+    uint32_t digits[];
+} Bignum;
+
+// An exact integer to compute with: a bignum's digits, or a fixnum's, split into
+// the buffer. Its digits may point into the heap, so it is only loaded once
+// nothing else is going to be allocated.
+typedef struct Integer {
+    bool negative;
+    int length;
+    const uint32_t *digits;
+    uint32_t buffer[2];
+} Integer;
+
+// The largest power of ten in a digit, for reading and printing
+#define DECIMAL_BASE 1000000000
+#define DECIMAL_DIGITS 9
+
+// Reports a bad argument to an arithmetic primitive
+void numberError(const char *message) {
+    printf("Evaluation error: %s\n", message);
+    texit(1);
+}
+
+// Returns whether item is a fixnum, bignum or double
+bool isNumber(SchemeItem *item) {
+    itemType type = typeOf(item);
+    return type == INT_TYPE || type == BIGNUM_TYPE || type == DOUBLE_TYPE;
+}
+
+// Returns whether item is a fixnum or a bignum
+bool isExactInteger(SchemeItem *item) {
+    return typeOf(item) == INT_TYPE || typeOf(item) == BIGNUM_TYPE;
+}
+
+// Allocates a bignum with room for length digits (all 0)
+Bignum *allocBignum(int length) {
+    Bignum *bignum = gcAlloc(GC_RAW, sizeof(Bignum) + length * sizeof(uint32_t));
+    bignum->type = BIGNUM_TYPE;
+    bignum->negative = false;
+    bignum->length = length;
+    return bignum;
+}
+
+// Drops a result's leading zero digits, and returns it as a fixnum if it fits in one
+SchemeItem *normalize(Bignum *bignum) {
+    while (bignum->length > 0 && bignum->digits[bignum->length - 1] == 0) {
+        bignum->length--;
+    }
+    if (bignum->length <= 2) {
+        uint64_t magnitude = 0;
+        for (int i = bignum->length - 1; i >= 0; i--) {
+            magnitude = (magnitude << 32) | bignum->digits[i];
+        }
+        if (!bignum->negative && magnitude <= (uint64_t)FIXNUM_MAX) {
+            return makeFixnum(magnitude);
+        }
+        if (bignum->negative && magnitude <= (uint64_t)FIXNUM_MAX + 1) {
+            return makeFixnum(-(long)magnitude);
+        }
+    }
+    return (SchemeItem *)bignum;
+}
+
+// Makes the exact integer for value, a fixnum if it fits
+SchemeItem *makeInteger(long value) {
+    if (value >= FIXNUM_MIN && value <= FIXNUM_MAX) {
+        return makeFixnum(value);
+    }
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    Bignum *bignum = allocBignum(2);
+    bignum->negative = value < 0;
+    bignum->digits[0] = (uint32_t)magnitude;
+    bignum->digits[1] = (uint32_t)(magnitude >> 32);
+    return normalize(bignum);
+}
+
+// Makes a double
+SchemeItem *makeDouble(double value) {
+    SchemeItem *item = makeItem(DOUBLE_TYPE);
+    item->d = value;
+    return item;
+}
+
+// Returns how many digits an exact integer can need, before it is loaded
+int integerLength(SchemeItem *item) {
+    return typeOf(item) == INT_TYPE ? 2 : ((Bignum *)item)->length;
+}
+
+// Loads an exact integer's sign and digits
+void loadInteger(Integer *integer, SchemeItem *item) {
+    if (typeOf(item) == INT_TYPE) {
+        long value = fixnumValue(item);
+        uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+        integer->negative = value < 0;
+        integer->buffer[0] = (uint32_t)magnitude;
+        integer->buffer[1] = (uint32_t)(magnitude >> 32);
+        integer->digits = integer->buffer;
+        integer->length = integer->buffer[1] != 0 ? 2 : (integer->buffer[0] != 0 ? 1 : 0);
+    } else {
+        Bignum *bignum = (Bignum *)item;
+        integer->negative = bignum->negative;
+        integer->digits = bignum->digits;
+        integer->length = bignum->length;
+    }
+}
+
+// Compares two magnitudes
+int compareMagnitudes(const Integer *left, const Integer *right) {
+    if (left->length != right->length) {
+        return left->length < right->length ? -1 : 1;
+    }
+    for (int i = left->length - 1; i >= 0; i--) {
+        if (left->digits[i] != right->digits[i]) {
+            return left->digits[i] < right->digits[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// result = |left| + |right|. result needs room for one digit more than the longer
+void addMagnitudes(uint32_t *result, const Integer *left, const Integer *right) {
+    const Integer *longer = left->length >= right->length ? left : right;
+    const Integer *shorter = longer == left ? right : left;
+    uint64_t carry = 0;
+    int i = 0;
+    for (; i < longer->length; i++) {
+        uint64_t sum = carry + longer->digits[i] + (i < shorter->length ? shorter->digits[i] : 0);
+        result[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    result[i] = (uint32_t)carry;
+}
+
+// result = |left| - |right|, where |left| >= |right|
+void subtractMagnitudes(uint32_t *result, const Integer *left, const Integer *right) {
+    int64_t borrow = 0;
+    for (int i = 0; i < left->length; i++) {
+        int64_t difference = (int64_t)left->digits[i] - (i < right->length ? right->digits[i] : 0) - borrow;
+        borrow = difference < 0;
+        result[i] = (uint32_t)(difference + (borrow << 32));
+    }
+}
+
+// Adds or subtracts two exact integers
+SchemeItem *addIntegers(SchemeItem *left, SchemeItem *right, bool subtract) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(left);
+    GC_ROOT(right);
+    int left_length = integerLength(left);
+    int right_length = integerLength(right);
+    Bignum *result = allocBignum((left_length > right_length ? left_length : right_length) + 1);
+    gcRestoreRoots(roots);
+
+    Integer x, y;
+    loadInteger(&x, left);
+    loadInteger(&y, right);
+    bool y_negative = y.negative != subtract;
+    if (x.negative == y_negative) {
+        addMagnitudes(result->digits, &x, &y);
+        result->negative = x.negative;
+    } else if (compareMagnitudes(&x, &y) >= 0) {
+        subtractMagnitudes(result->digits, &x, &y);
+        result->negative = x.negative;
+    } else {
+        subtractMagnitudes(result->digits, &y, &x);
+        result->negative = y_negative;
+    }
+    return normalize(result);
+}
+
+// Multiplies two exact integers (schoolbook)
+SchemeItem *multiplyIntegers(SchemeItem *left, SchemeItem *right) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(left);
+    GC_ROOT(right);
+    Bignum *result = allocBignum(integerLength(left) + integerLength(right));
+    gcRestoreRoots(roots);
+
+    Integer x, y;
+    loadInteger(&x, left);
+    loadInteger(&y, right);
+    for (int i = 0; i < x.length; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < y.length; j++) {
+            uint64_t product = (uint64_t)x.digits[i] * y.digits[j] + result->digits[i + j] + carry;
+            result->digits[i + j] = (uint32_t)product;
+            carry = product >> 32;
+        }
+        result->digits[i + y.length] = (uint32_t)carry;
+    }
+    result->negative = x.negative != y.negative;
+    return normalize(result);
+}
+
+// Divides magnitudes: quotient (m - n + 1 digits) and remainder (n digits) of u
+// (m digits) by v (n digits, the top one non-zero, m >= n). This is Knuth's
+// algorithm D, as in Hacker's Delight.
+void divideMagnitudes(uint32_t *quotient, uint32_t *remainder, const uint32_t *u, int m, const uint32_t *v, int n) {
+    const uint64_t base = 1ULL << 32;
+
+    if (n == 1) {
+        uint64_t rest = 0;
+        for (int j = m - 1; j >= 0; j--) {
+            uint64_t current = (rest << 32) | u[j];
+            quotient[j] = (uint32_t)(current / v[0]);
+            rest = current % v[0];
+        }
+        remainder[0] = (uint32_t)rest;
+        return;
+    }
+
+    // shift the divisor left until its top bit is set, and the dividend with it
+    int shift = __builtin_clz(v[n - 1]);
+    uint32_t *vn = malloc(n * sizeof(uint32_t));
+    uint32_t *un = malloc((m + 1) * sizeof(uint32_t));
+    for (int i = n - 1; i > 0; i--) {
+        vn[i] = (v[i] << shift) | (uint32_t)((uint64_t)v[i - 1] >> (32 - shift));
+    }
+    vn[0] = v[0] << shift;
+    un[m] = (uint32_t)((uint64_t)u[m - 1] >> (32 - shift));
+    for (int i = m - 1; i > 0; i--) {
+        un[i] = (u[i] << shift) | (uint32_t)((uint64_t)u[i - 1] >> (32 - shift));
+    }
+    un[0] = u[0] << shift;
+
+    for (int j = m - n; j >= 0; j--) {
+        // estimate the next quotient digit from the top two digits, then correct it
+        uint64_t numerator = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+        uint64_t qhat = numerator / vn[n - 1];
+        uint64_t rhat = numerator % vn[n - 1];
+        while (qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            qhat--;
+            rhat = rhat + vn[n - 1];
+            if (rhat >= base) {
+                break;
+            }
+        }
+
+        // multiply and subtract
+        int64_t borrow = 0;
+        int64_t t;
+        for (int i = 0; i < n; i++) {
+            uint64_t product = qhat * vn[i];
+            t = un[i + j] - borrow - (int64_t)(product & 0xFFFFFFFF);
+            un[i + j] = (uint32_t)t;
+            borrow = (int64_t)(product >> 32) - (t >> 32);
+        }
+        t = un[j + n] - borrow;
+        un[j + n] = (uint32_t)t;
+
+        quotient[j] = (uint32_t)qhat;
+        if (t < 0) {
+            // the estimate was one too big: add the divisor back
+            quotient[j]--;
+            uint64_t carry = 0;
+            for (int i = 0; i < n; i++) {
+                uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+                un[i + j] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+            un[j + n] = un[j + n] + (uint32_t)carry;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        remainder[i] = (un[i] >> shift) | (uint32_t)((uint64_t)un[i + 1] << (32 - shift));
+    }
+    free(vn);
+    free(un);
+}
+
+// Divides two exact integers, truncating toward zero. Either result pointer may
+// be NULL if it isn't wanted.
+void divideIntegers(SchemeItem *left, SchemeItem *right, SchemeItem **quotient, SchemeItem **remainder) {
+    Integer x, y;
+    loadInteger(&y, right);
+    if (y.length == 0) {
+        numberError("division by zero");
+    }
+    loadInteger(&x, left);
+    if (compareMagnitudes(&x, &y) < 0) {
+        if (quotient != NULL) {
+            *quotient = makeFixnum(0);
+        }
+        if (remainder != NULL) {
+            *remainder = left;
+        }
+        return;
+    }
+
+    int m = x.length;
+    int n = y.length;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(left);
+    GC_ROOT(right);
+    Bignum *q = allocBignum(m - n + 1);
+    GC_ROOT(q);
+    Bignum *r = allocBignum(n);
+    gcRestoreRoots(roots);
+
+    loadInteger(&x, left);
+    loadInteger(&y, right);
+    divideMagnitudes(q->digits, r->digits, x.digits, m, y.digits, n);
+    q->negative = x.negative != y.negative;
+    r->negative = x.negative;
+    if (quotient != NULL) {
+        *quotient = normalize(q);
+    }
+    if (remainder != NULL) {
+        *remainder = normalize(r);
+    }
+}
+
+// Checks that both arguments are numbers, and returns whether either is a double
+bool inexact(SchemeItem *left, SchemeItem *right) {
+    if (!isNumber(left) || !isNumber(right)) {
+        numberError("not a number");
+    }
+    return typeOf(left) == DOUBLE_TYPE || typeOf(right) == DOUBLE_TYPE;
+}
+
+// The operands of quotient, remainder and modulo must be integers. An inexact one
+// is worked on exactly, and the result made inexact again.
+long inexactInteger(SchemeItem *item) {
+    double value = numberToDouble(item);
+    if (value < -9e18 || value > 9e18 || value != (double)(long)value) {
+        numberError("expected an integer");
+    }
+    return (long)value;
+}
+
+// The arithmetic operations (see number.h). Two fixnums take the fast path, and
+// anything with a double in it is done in doubles
+SchemeItem *numberAdd(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE) {
+        // two fixnums can't overflow a long, only the fixnum range
+        return makeInteger(fixnumValue(left) + fixnumValue(right));
+    }
+    if (inexact(left, right)) {
+        return makeDouble(numberToDouble(left) + numberToDouble(right));
+    }
+    return addIntegers(left, right, false);
+}
+
+SchemeItem *numberSubtract(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE) {
+        return makeInteger(fixnumValue(left) - fixnumValue(right));
+    }
+    if (inexact(left, right)) {
+        return makeDouble(numberToDouble(left) - numberToDouble(right));
+    }
+    return addIntegers(left, right, true);
+}
+
+SchemeItem *numberMultiply(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE) {
+        long product;
+        if (!__builtin_mul_overflow(fixnumValue(left), fixnumValue(right), &product)) {
+            return makeInteger(product);
+        }
+    } else if (inexact(left, right)) {
+        return makeDouble(numberToDouble(left) * numberToDouble(right));
+    }
+    return multiplyIntegers(left, right);
+}
+
+SchemeItem *numberDivide(SchemeItem *left, SchemeItem *right) {
+    if (inexact(left, right)) {
+        return makeDouble(numberToDouble(left) / numberToDouble(right));
+    }
+
+    SchemeItem *quotient;
+    SchemeItem *remainder;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(left);
+    GC_ROOT(right);
+    divideIntegers(left, right, &quotient, &remainder);
+    gcRestoreRoots(roots);
+
+    if (remainder == makeFixnum(0)) {
+        return quotient;
+    }
+    return makeDouble(numberToDouble(left) / numberToDouble(right));
+}
+
+SchemeItem *numberQuotient(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE && right != makeFixnum(0)) {
+        return makeInteger(fixnumValue(left) / fixnumValue(right));
+    }
+    if (inexact(left, right)) {
+        long divisor = inexactInteger(right);
+        if (divisor == 0) {
+            numberError("division by zero");
+        }
+        return makeDouble(inexactInteger(left) / divisor);
+    }
+    SchemeItem *quotient;
+    divideIntegers(left, right, &quotient, NULL);
+    return quotient;
+}
+
+SchemeItem *numberRemainder(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE && right != makeFixnum(0)) {
+        return makeFixnum(fixnumValue(left) % fixnumValue(right));
+    }
+    if (inexact(left, right)) {
+        long divisor = inexactInteger(right);
+        if (divisor == 0) {
+            numberError("division by zero");
+        }
+        return makeDouble(inexactInteger(left) % divisor);
+    }
+    SchemeItem *remainder;
+    divideIntegers(left, right, NULL, &remainder);
+    return remainder;
+}
+
+SchemeItem *numberModulo(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE && right != makeFixnum(0)) {
+        long divisor = fixnumValue(right);
+        long modulo = fixnumValue(left) % divisor;
+        if (modulo != 0 && (modulo < 0) != (divisor < 0)) {
+            modulo = modulo + divisor;
+        }
+        return makeFixnum(modulo);
+    }
+    if (inexact(left, right)) {
+        long divisor = inexactInteger(right);
+        if (divisor == 0) {
+            numberError("division by zero");
+        }
+        long modulo = inexactInteger(left) % divisor;
+        if (modulo != 0 && (modulo < 0) != (divisor < 0)) {
+            modulo = modulo + divisor;
+        }
+        return makeDouble(modulo);
+    }
+
+    // a remainder with the other sign from the divisor moves over by one divisor
+    size_t roots = gcSaveRoots();
+    GC_ROOT(right);
+    SchemeItem *remainder;
+    divideIntegers(left, right, NULL, &remainder);
+    if (remainder != makeFixnum(0) && (numberCompare(remainder, makeFixnum(0)) < 0) != (numberCompare(right, makeFixnum(0)) < 0)) {
+        remainder = addIntegers(remainder, right, false);
+    }
+    gcRestoreRoots(roots);
+    return remainder;
+}
+
+// Compares a double with an exact integer without rounding the integer, which a
+// double can't hold exactly past 2^53. The double's whole part is split into
+// digits (dividing by powers of two, so exactly) and compared as an integer, and
+// any fraction it had breaks a tie.
+int compareDoubleInteger(double value, SchemeItem *integer) {
+    if (value != value) {
+        return NUMBER_UNORDERED;
+    }
+    if (value - value != 0) {
+        return value > 0 ? 1 : -1;
+    }
+    if (typeOf(integer) == INT_TYPE) {
+        long exact = fixnumValue(integer);
+        if (exact >= -9007199254740992L && exact <= 9007199254740992L) {
+            double y = exact;
+            return (value > y) - (value < y);
+        }
+    }
+
+    // a double is below 2^1024, so its whole part fits in 32 digits
+    uint32_t digits[32];
+    double rest = value < 0 ? -value : value;
+    double scale = 1;
+    int length = 1;
+    while (rest / scale >= 4294967296.0) {
+        scale = scale * 4294967296.0;
+        length++;
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        digits[i] = (uint32_t)(rest / scale);
+        rest = rest - digits[i] * scale;
+        scale = scale / 4294967296.0;
+    }
+    while (length > 0 && digits[length - 1] == 0) {
+        length--;
+    }
+
+    Integer x, y;
+    x.negative = value < 0 && length > 0;
+    x.digits = digits;
+    x.length = length;
+    loadInteger(&y, integer);
+    if (x.negative != y.negative) {
+        return x.negative ? -1 : 1;
+    }
+    int magnitude = compareMagnitudes(&x, &y);
+    if (magnitude == 0 && rest > 0) {
+        return value < 0 ? -1 : 1;
+    }
+    return x.negative ? -magnitude : magnitude;
+}
+
+// Compares two numbers, without allocating
+int numberCompare(SchemeItem *left, SchemeItem *right) {
+    if (typeOf(left) == INT_TYPE && typeOf(right) == INT_TYPE) {
+        long x = fixnumValue(left);
+        long y = fixnumValue(right);
+        return (x > y) - (x < y);
+    }
+    if (inexact(left, right)) {
+        if (typeOf(right) != DOUBLE_TYPE) {
+            return compareDoubleInteger(left->d, right);
+        }
+        if (typeOf(left) != DOUBLE_TYPE) {
+            int order = compareDoubleInteger(right->d, left);
+            return order == NUMBER_UNORDERED ? order : -order;
+        }
+        double x = left->d;
+        double y = right->d;
+        if (x != x || y != y) {
+            return NUMBER_UNORDERED;
+        }
+        return (x > y) - (x < y);
+    }
+
+    Integer x, y;
+    loadInteger(&x, left);
+    loadInteger(&y, right);
+    if (x.negative != y.negative) {
+        return x.negative ? -1 : 1;
+    }
+    int magnitude = compareMagnitudes(&x, &y);
+    return x.negative ? -magnitude : magnitude;
+}
+
+// Hashes an exact integer: a fixnum is its own value, and a bignum mixes its digits
+uint64_t integerHash(SchemeItem *item) {
+    if (typeOf(item) == INT_TYPE) {
+        return (uint64_t)fixnumValue(item);
+    }
+    Bignum *bignum = (Bignum *)item;
+    uint64_t hash = 14695981039346656037ULL ^ bignum->negative;
+    for (int i = 0; i < bignum->length; i++) {
+        hash = (hash ^ bignum->digits[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Returns the value of any number as a double
+double numberToDouble(SchemeItem *item) {
+    switch (typeOf(item)) {
+        case INT_TYPE:
+            return fixnumValue(item);
+        case DOUBLE_TYPE:
+            return item->d;
+        case BIGNUM_TYPE: {
+            Bignum *bignum = (Bignum *)item;
+            double value = 0;
+            for (int i = bignum->length - 1; i >= 0; i--) {
+                value = value * 4294967296.0 + bignum->digits[i];
+            }
+            return bignum->negative ? -value : value;
+        }
+        default:
+            numberError("not a number");
+            return 0;
+    }
+}
+
+// Multiplies a bignum's digits by factor and adds addend, in place. Used to read
+// a literal nine decimal digits at a time, into a bignum with room to spare.
+void multiplyAdd(Bignum *bignum, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (int i = 0; i < bignum->length; i++) {
+        uint64_t product = (uint64_t)bignum->digits[i] * factor + carry;
+        bignum->digits[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    if (carry != 0) {
+        bignum->digits[bignum->length++] = (uint32_t)carry;
+    }
+}
+
+// Reads an integer literal of any size (see number.h)
+SchemeItem *parseInteger(const char *text, size_t length) {
+    bool negative = text[0] == '-';
+    size_t start = (text[0] == '-' || text[0] == '+') ? 1 : 0;
+
+    // up to 18 digits always fit in a fixnum
+    if (length - start <= 18) {
+        long value = 0;
+        for (size_t i = start; i < length; i++) {
+            value = value * 10 + (text[i] - '0');
+        }
+        return makeFixnum(negative ? -value : value);
+    }
+
+    // every nine decimal digits need at most one more base 2^32 digit
+    Bignum *bignum = allocBignum((length - start) / DECIMAL_DIGITS + 2);
+    bignum->length = 0;
+    size_t position = start;
+    while (position < length) {
+        size_t count = (length - position) % DECIMAL_DIGITS;
+        if (count == 0) {
+            count = DECIMAL_DIGITS;
+        }
+        uint32_t chunk = 0;
+        uint32_t factor = 1;
+        for (size_t i = 0; i < count; i++) {
+            chunk = chunk * 10 + (text[position + i] - '0');
+            factor = factor * 10;
+        }
+        multiplyAdd(bignum, factor, chunk);
+        position = position + count;
+    }
+    bignum->negative = negative;
+    return normalize(bignum);
+}
+
+// Returns the decimal digits of a bignum, in a string the caller must free
+char *bignumToString(SchemeItem *item) {
+    Bignum *bignum = (Bignum *)item;
+
+    // take nine decimal digits at a time off the bottom of a copy of the digits
+    int length = bignum->length;
+    uint32_t *digits = malloc(length * sizeof(uint32_t));
+    memcpy(digits, bignum->digits, length * sizeof(uint32_t));
+    size_t chunk_count = 0;
+    uint32_t *chunks = malloc((length * 10 / DECIMAL_DIGITS + 2) * sizeof(uint32_t));
+    do {
+        uint64_t rest = 0;
+        for (int i = length - 1; i >= 0; i--) {
+            uint64_t current = (rest << 32) | digits[i];
+            digits[i] = (uint32_t)(current / DECIMAL_BASE);
+            rest = current % DECIMAL_BASE;
+        }
+        chunks[chunk_count++] = (uint32_t)rest;
+        while (length > 0 && digits[length - 1] == 0) {
+            length--;
+        }
+    } while (length > 0);
+
+    char *text = malloc(chunk_count * DECIMAL_DIGITS + 2);
+    char *end = text;
+    if (bignum->negative) {
+        *end++ = '-';
+    }
+    end = end + sprintf(end, "%u", chunks[chunk_count - 1]);
+    for (size_t i = chunk_count - 1; i > 0; i--) {
+        end = end + sprintf(end, "%09u", chunks[i - 1]);
+    }
+
+    free(digits);
+    free(chunks);
+    return text;
+}
@@ -0,0 +1,70 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include "schemeitem.h"
+
+#ifndef _NUMBER
+#define _NUMBER
+
+// The numeric tower. Exact integers are fixnums (see schemeitem.h) as long as they
+// fit in one, and BIGNUM_TYPE objects of any size once they don't. Every operation
+// takes the fixnum path first and checks it for overflow; a bignum result that fits
+// in a fixnum again is always turned back into one, so an integer has exactly one
+// representation. Inexact numbers are doubles, and any operation with a double in
+// it gives a double.
+//
+// These all report an error and exit when given something that isn't a number.
+// The ones that make a new number can collect, so callers must root anything else
+// they hold.
+
+#define FIXNUM_MAX (LONG_MAX >> 1)
+#define FIXNUM_MIN (LONG_MIN >> 1)
+
+// Returns whether item is a fixnum, bignum or double
+bool isNumber(SchemeItem *item);
+
+// Returns whether item is an exact integer (a fixnum or a bignum)
+bool isExactInteger(SchemeItem *item);
+
+// Makes the exact integer for value, a fixnum if it fits
+SchemeItem *makeInteger(long value);
+
+// Makes a double
+SchemeItem *makeDouble(double value);
+
+// Reads an integer literal of any size: digits with an optional sign, length
+// bytes long (a slice of the reader's buffer, not null terminated)
+SchemeItem *parseInteger(const char *text, size_t length);
+
+// Arithmetic. numberDivide gives an exact result when the division is exact and
+// a double otherwise (there are no rationals). quotient and remainder truncate
+// toward zero; modulo takes the sign of the divisor.
+SchemeItem *numberAdd(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberSubtract(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberMultiply(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberDivide(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberQuotient(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberRemainder(SchemeItem *left, SchemeItem *right);
+SchemeItem *numberModulo(SchemeItem *left, SchemeItem *right);
+
+// What numberCompare returns when either number is a NaN, which is neither less
+// than, equal to nor greater than anything
+#define NUMBER_UNORDERED 2
+
+// Returns -1, 0 or 1 as left is less than, equal to or greater than right, or
+// NUMBER_UNORDERED. An exact integer is compared with a double exactly, not by
+// rounding it to a double. Never allocates.
+int numberCompare(SchemeItem *left, SchemeItem *right);
+
+// Hashes an exact integer. Equal integers hash the same, since each has only one
+// representation. Never allocates.
+uint64_t integerHash(SchemeItem *integer);
+
+// Returns the value of any number as a double
+double numberToDouble(SchemeItem *item);
+
+// Returns the decimal digits of a bignum, in a string the caller must free
+char *bignumToString(SchemeItem *bignum);
+
+#endif
@@ -2,35 +2,40 @@
 #include "linkedlist.h"
 #include "talloc.h"
 #include "tokenizer.h"
+#include "gc.h"
+#include "symbols.h"
+#include "port.h"
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
-#include <assert.h>
 
 // Helper function to print a syntax error.
 void syntaxError() {
-    printf("Syntax Error!");
+    printf("Syntax Error!\n");
 }
 
 // Adds a Scheme Item (item) to the front of the provided stack (stack)
-// If begins with quote '(..), will remove and replace with "quote"
+// If begins with quote '(..), will remove and replace with "quote" (as many times as there are quotes)
 // Otherwise will just add
 SchemeItem *push(SchemeItem *stack, SchemeItem *item) {
-    if (stack->type == CONS_TYPE && car(stack)->type == SINGLEQUOTE_TYPE) {
+    if (typeOf(stack) == CONS_TYPE && typeOf(car(stack)) == SINGLEQUOTE_TYPE) {
+        size_t roots = gcSaveRoots();
+        GC_ROOT(stack);
+        GC_ROOT(item);
+
         // remove quote
         stack = cdr(stack);
 
 
-        SchemeItem *quote_item = makeEmpty();
-        quote_item->type = SYMBOL_TYPE;
-        quote_item->s = talloc(6);
-        strcpy(quote_item->s, "quote");
+        SchemeItem *quote_item = intern("quote");
 
         SchemeItem *list_w_quote = makeEmpty();
         list_w_quote = cons(item, list_w_quote);
         list_w_quote = cons(quote_item, list_w_quote);
-        return cons(list_w_quote, stack);
+
+        gcRestoreRoots(roots);
+        return push(stack, list_w_quote); // the quote itself may be quoted
     }
 
     return cons(item, stack);
@@ -40,29 +45,36 @@ SchemeItem *push(SchemeItem *stack, SchemeItem *item) {
 // Groups tokens based on matching parenthesis
 // When open is found it pushes token onto stack
 // When closed is found it pops until matching open is found, then pushes list onto stack
+// (or, if the open was a #(, a constant vector of the list's elements)
 // 
 // Handles quotes by removing ' and replacing it with quote
 // Syntax error if unbalanced parenthesis
 SchemeItem *addToParseTree(SchemeItem *parse_stack, int *current_depth, SchemeItem *token) { //token = car(current), 
-    if (token->type == OPEN_TYPE) {
+    if (typeOf(token) == OPEN_TYPE || typeOf(token) == OPENVECTOR_TYPE) {
         *current_depth = *current_depth + 1; // add one to depth, one (
         return cons(token, parse_stack);
     }
     
-    if (token->type == CLOSE_TYPE) {
+    if (typeOf(token) == CLOSE_TYPE) {
         if (*current_depth == 0) {
             syntaxError();
         }
 
+        size_t roots = gcSaveRoots();
+        GC_ROOT(parse_stack);
+
         SchemeItem *inner_list = makeEmpty();
+        GC_ROOT(inner_list);
         bool matched = false;
+        bool vector = false;
 
-        while (parse_stack->type == CONS_TYPE) {
+        while (typeOf(parse_stack) == CONS_TYPE) {
             SchemeItem *top = car(parse_stack);
             parse_stack = cdr(parse_stack);
 
-            if ((top->type == OPEN_TYPE) || (top->type == OPENBRACKET_TYPE)) {
+            if ((typeOf(top) == OPEN_TYPE) || (typeOf(top) == OPENBRACKET_TYPE) || (typeOf(top) == OPENVECTOR_TYPE)) {
                 matched = true;
+                vector = typeOf(top) == OPENVECTOR_TYPE;
                 break;
             }
 
@@ -75,10 +87,16 @@ SchemeItem *addToParseTree(SchemeItem *parse_stack, int *current_depth, SchemeIt
 
         *current_depth = *current_depth - 1;
 
+        if (vector) {
+            inner_list = listToVector(inner_list);
+            ((Vector *)inner_list)->constant = true;
+        }
+
+        gcRestoreRoots(roots);
         return push(parse_stack, inner_list);
     }
 
-    if (token->type == SINGLEQUOTE_TYPE) {
+    if (typeOf(token) == SINGLEQUOTE_TYPE) {
         return cons(token, parse_stack);
     }
 
@@ -86,98 +104,58 @@ SchemeItem *addToParseTree(SchemeItem *parse_stack, int *current_depth, SchemeIt
     return push(parse_stack, token);
 }
 
-// Converts a linked list of tokens into a parse tree
-// Goes through each token using the helper function addToParseTree for each token
-// Throws syntax error if not all open parthesis are closed
-// Reverses stack for original order of tokens
-SchemeItem *parse(SchemeItem *tokens) {
-    int *current_depth = talloc(sizeof(int));
-    *current_depth = 0;
+// Reads the next top-level datum from stdin, one token at a time, and returns it,
+// or NULL once the input runs out. Stops as soon as the datum is complete, so the
+// rest of the input hasn't been read yet.
+//
+// Exits with a syntax error if the parentheses don't balance
+SchemeItem *readDatum() {
+    int current_depth = 0;
     SchemeItem *parse_stack = makeEmpty();
+    size_t roots = gcSaveRoots();
+    GC_ROOT(parse_stack);
 
-    SchemeItem *current = tokens;
-    assert(current != NULL && "Error (parse): null pointer");
+    SchemeItem *token = readToken();
+    while (token != NULL) {
+        if (typeOf(token) == CLOSE_TYPE && current_depth == 0) {
+            syntaxError();
+            texit(1);
+        }
+        parse_stack = addToParseTree(parse_stack, &current_depth, token);
 
-    // Go through each token
-    while (current->type != EMPTY_TYPE) {
-        SchemeItem *token = car(current);
-        parse_stack = addToParseTree(parse_stack, current_depth, token);
-        current = cdr(current);
+        // done once we are back at the top level, with no quote waiting for its datum
+        if (current_depth == 0 && typeOf(car(parse_stack)) != SINGLEQUOTE_TYPE) {
+            gcRestoreRoots(roots);
+            return car(parse_stack);
+        }
+        token = readToken();
     }
-    if (*current_depth != 0) {
+
+    gcRestoreRoots(roots);
+    if (typeOf(parse_stack) != EMPTY_TYPE) {
         syntaxError();
+        texit(1);
     }
-
-    parse_stack = reverse(parse_stack);
-
-    return parse_stack;
+    return NULL;
 }
 
-// A helper function that prints the provided SchemeItem pointed to by (item)
-// For a list of cons cells, Will print each item with a space between them until reaches end of list
+// A helper function that prints the provided SchemeItem pointed to by (item) to the
+// current output port, the way results are printed (see portWriteItem)
 void printItem(SchemeItem *item) {
-    switch (item->type){
-        case CONS_TYPE: 
-            printf("(");
-            
-            SchemeItem *current = item;
-            bool first = true;
-
-            while (current->type == CONS_TYPE){
-                if (first == false) {
-                    printf(" ");
-                }
-
-                printItem(car(current));
-                first = false;
-
-                current = cdr(current);
-            }
-            if (current->type != EMPTY_TYPE) {
-                printf(" . ");
-                printItem(current);
-            }
-            printf(")");
-            break;
-        case EMPTY_TYPE:
-            printf("()"); 
-            break;
-        case INT_TYPE:
-            printf("%i", item->i); 
-            break;
-        case DOUBLE_TYPE:
-            printf("%f", item->d); 
-            break;
-        case STR_TYPE:
-            printf("%s", item->s); 
-            break;
-        case SYMBOL_TYPE:
-            printf("%s", item->s); 
-            break;
-        case BOOL_TYPE:
-            printf("%s", item->s); 
-            break;
-        case CLOSURE_TYPE:
-            printf("#<procedure>");
-            break;
-        case VOID_TYPE:
-            break;
-        default: 
-            break;
-    }
+    portWriteItem(currentOutput(), item, false);
 }
 
 // Prints the tree like it is scheme code
 void printTree(SchemeItem *tree) {
     SchemeItem *current = tree;
     
-    while (current->type == CONS_TYPE) {
+    while (typeOf(current) == CONS_TYPE) {
         printItem(car(current));
-        if (cdr(current)->type == CONS_TYPE) { // we have something next
-            printf(" ");
+        if (typeOf(cdr(current)) == CONS_TYPE) { // we have something next
+            portWriteString(currentOutput(), " ");
         }
 
         current = cdr(current);
     }
-    printf("\n");
-}
\ No newline at end of file
+    portWriteString(currentOutput(), "\n");
+}
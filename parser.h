@@ -3,9 +3,9 @@
 #ifndef _PARSER
 #define _PARSER
 
-// Takes a list of tokens from a Scheme program, and returns a pointer to a
-// parse tree representing that program.
-SchemeItem *parse(SchemeItem *tokens);
+// Reads the next top-level datum from stdin, or returns NULL at the end of the
+// input. Only reads as far as the end of that datum.
+SchemeItem *readDatum();
 
 
 // Prints the tree to the screen in a readable fashion. It should look just like
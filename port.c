@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "schemeitem.h"
+#include "talloc.h"
+#include "port.h"
+#include "number.h"
+#include "schemestring.h"
+
+// How much a file port holds before it is written out
+#define PORT_BUFFER_SIZE (64 * 1024)
+
+Port *current_output = NULL;
+Port *standard_output = NULL;
+Port *open_ports = NULL;
+
+// Makes a port for the file descriptor fd, or a string port if fd is -1
+Port *makePort(int fd) {
+    Port *port = talloc(sizeof(Port));
+    port->fd = fd;
+    port->capacity = fd < 0 ? 256 : PORT_BUFFER_SIZE;
+    port->buffer = malloc(port->capacity);
+    port->length = 0;
+    port->open = true;
+    port->next = open_ports;
+    open_ports = port;
+    return port;
+}
+
+// Makes the port for standard output, and makes it the current output port
+void initPorts() {
+    standard_output = makePort(STDOUT_FILENO);
+    current_output = standard_output;
+}
+
+// Returns the current output port
+Port *currentOutput() {
+    return current_output;
+}
+
+// Makes port the current output port
+void setCurrentOutput(Port *port) {
+    current_output = port;
+}
+
+// Writes all of text to fd, giving up if there is an error
+void writeAll(int fd, const char *text, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t count = write(fd, text + written, length - written);
+        if (count <= 0) {
+            return;
+        }
+        written = written + count;
+    }
+}
+
+// Hands everything in a file port's buffer to the operating system
+void flushPort(Port *port) {
+    if (port->fd < 0) {
+        return;
+    }
+    writeAll(port->fd, port->buffer, port->length);
+    port->length = 0;
+}
+
+// Writes length bytes to the port. A file port writes out its buffer first if
+// they don't fit (and text too big for the buffer at all is written straight
+// out). A string port grows its buffer instead.
+void portWrite(Port *port, const char *text, size_t length) {
+    if (!port->open) {
+        printf("Evaluation error: port is closed\n");
+        texit(1);
+    }
+
+    if (port->length + length > port->capacity) {
+        if (port->fd < 0) {
+            while (port->length + length > port->capacity) {
+                port->capacity = port->capacity * 2;
+            }
+            port->buffer = realloc(port->buffer, port->capacity);
+        } else {
+            flushPort(port);
+            if (length > port->capacity) {
+                writeAll(port->fd, text, length);
+                return;
+            }
+        }
+    }
+
+    memcpy(port->buffer + port->length, text, length);
+    port->length = port->length + length;
+}
+
+// Writes a null terminated string to the port
+void portWriteString(Port *port, const char *text) {
+    portWrite(port, text, strlen(text));
+}
+
+// Writes an item to the port (see port.h). Lists may end in a dotted tail
+void portWriteItem(Port *port, SchemeItem *item, bool display) {
+    char number[64];
+
+    switch (typeOf(item)) {
+        case CONS_TYPE: {
+            portWrite(port, "(", 1);
+
+            SchemeItem *current = item;
+            bool first = true;
+            while (typeOf(current) == CONS_TYPE) {
+                if (first == false) {
+                    portWrite(port, " ", 1);
+                }
+                portWriteItem(port, current->car, display);
+                first = false;
+                current = current->cdr;
+            }
+            if (typeOf(current) != EMPTY_TYPE) {
+                portWrite(port, " . ", 3);
+                portWriteItem(port, current, display);
+            }
+            portWrite(port, ")", 1);
+            break;
+        }
+        case VECTOR_TYPE: {
+            Vector *vector = (Vector *)item;
+            portWrite(port, "#(", 2);
+            for (long i = 0; i < vector->length; i++) {
+                if (i > 0) {
+                    portWrite(port, " ", 1);
+                }
+                portWriteItem(port, vector->items[i], display);
+            }
+            portWrite(port, ")", 1);
+            break;
+        }
+        case EMPTY_TYPE:
+            portWrite(port, "()", 2);
+            break;
+        case INT_TYPE:
+            portWrite(port, number, snprintf(number, sizeof(number), "%ld", fixnumValue(item)));
+            break;
+        case BIGNUM_TYPE: {
+            char *digits = bignumToString(item);
+            portWriteString(port, digits);
+            free(digits);
+            break;
+        }
+        case DOUBLE_TYPE:
+            portWrite(port, number, snprintf(number, sizeof(number), "%f", item->d));
+            break;
+        case STR_TYPE:
+            if (!display) {
+                portWrite(port, "\"", 1);
+            }
+            portWrite(port, stringChars(item), item->length);
+            if (!display) {
+                portWrite(port, "\"", 1);
+            }
+            break;
+        case SYMBOL_TYPE:
+            portWriteString(port, item->s);
+            break;
+        case BOOL_TYPE:
+            portWrite(port, item == SCHEME_TRUE ? "#t" : "#f", 2);
+            break;
+        case CLOSURE_TYPE:
+            portWriteString(port, "#<procedure>");
+            break;
+        case PORT_TYPE:
+            portWriteString(port, "#<port>");
+            break;
+        case HASHTABLE_TYPE:
+            portWriteString(port, "#<hash-table>");
+            break;
+        case VOID_TYPE:
+            break;
+        default:
+            break;
+    }
+}
+
+// Flushes and closes a port, freeing its buffer
+void closePort(Port *port) {
+    if (!port->open) {
+        return;
+    }
+    flushPort(port);
+    if (port->fd > STDERR_FILENO) {
+        close(port->fd);
+    }
+    free(port->buffer);
+    port->buffer = NULL;
+    port->open = false;
+
+    Port **link = &open_ports;
+    while (*link != port) {
+        link = &(*link)->next;
+    }
+    *link = port->next;
+}
+
+// Closes every port that is still open
+void closeAllPorts() {
+    while (open_ports != NULL) {
+        closePort(open_ports);
+    }
+}
@@ -0,0 +1,52 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _PORT
+#define _PORT
+
+// An output port. Everything written to it collects in a buffer, which is only
+// handed to the operating system (one write call) when it fills up or the port
+// is flushed. A string port has no file, and its buffer just grows.
+typedef struct Port {
+    int fd;          // -1 for a string port
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    bool open;
+    struct Port *next; // the next open port, so they can all be closed on exit
+} Port;
+
+// Makes the port for standard output, and makes it the current output port
+void initPorts();
+
+// The current output port is where display, write, newline and printed results
+// go when no port is given. It is standard output, except inside
+// with-output-to-string.
+Port *currentOutput();
+void setCurrentOutput(Port *port);
+
+// Makes a port for the file descriptor fd, or a string port if fd is -1
+Port *makePort(int fd);
+
+// Writes length bytes to the port
+void portWrite(Port *port, const char *text, size_t length);
+
+// Writes a null terminated string to the port
+void portWriteString(Port *port, const char *text);
+
+// Writes an item to the port. With display, strings are written without their
+// quotes. Otherwise it is written the way the interpreter prints results.
+void portWriteItem(Port *port, SchemeItem *item, bool display);
+
+// Hands everything in a file port's buffer to the operating system
+void flushPort(Port *port);
+
+// Flushes and closes a port, freeing its buffer
+void closePort(Port *port);
+
+// Closes every port that is still open (texit calls this, so buffered output
+// isn't lost)
+void closeAllPorts();
+
+#endif
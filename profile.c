@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "schemeitem.h"
+#include "profile.h"
+
+// Microseconds of CPU time between samples
+#define PROFILE_INTERVAL 1000
+
+// Only this many of the innermost procedures of a stack are recorded. The rest of
+// a deeper stack is folded into one "..." frame at its root.
+#define PROFILE_MAX_DEPTH 256
+
+// How many procedures (and callers) the printed profiles list. The folded stacks
+// have everything.
+#define PROFILE_ROWS 30
+
+// One distinct stack that samples have landed in, outermost procedure first.
+// A NULL name is a lambda that wasn't bound to a variable.
+typedef struct Stack {
+    SchemeItem **names;
+    int depth;
+    bool truncated;
+    size_t count;
+    uint64_t hash;
+    struct Stack *next; // the next stack in the same bucket
+} Stack;
+
+// The samples for one procedure, or for one caller and callee pair
+typedef struct Tally {
+    SchemeItem *caller;
+    SchemeItem *callee;
+    size_t self;
+    size_t total;
+    size_t last_stack; // the last stack counted in total, so recursion counts once
+    bool used;
+} Tally;
+
+bool profiling = false;
+const char *folded_path = NULL;
+volatile sig_atomic_t pending_ticks = 0;
+
+// The closures that are running, by name, innermost last
+SchemeItem **shadow_stack = NULL;
+size_t shadow_depth = 0;
+size_t shadow_capacity = 0;
+
+// Every distinct stack sampled, in a chained hash table
+Stack **stack_table = NULL;
+size_t stack_buckets = 0;
+size_t stack_count = 0;
+size_t sample_count = 0;
+
+// The SIGPROF handler: just counts the tick (see profile.h)
+void countTick(int signal) {
+    pending_ticks++;
+}
+
+// Starts the profiling timer (see profile.h)
+void profileStart(const char *path) {
+    folded_path = path;
+    shadow_capacity = 1024;
+    shadow_stack = malloc(shadow_capacity * sizeof(SchemeItem *));
+    stack_buckets = 1024;
+    stack_table = calloc(stack_buckets, sizeof(Stack *));
+    profiling = true;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = countTick;
+    action.sa_flags = SA_RESTART; // so a tick doesn't fail a read or write
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    struct itimerval timer = {{0, PROFILE_INTERVAL}, {0, PROFILE_INTERVAL}};
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+// Hashes the names of a stack (FNV-1a over the pointers)
+uint64_t hashStack(SchemeItem **names, int depth, bool truncated) {
+    uint64_t hash = 14695981039346656037ULL ^ truncated;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ (uintptr_t)names[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Doubles the number of buckets in the stack table
+void growStackTable() {
+    size_t buckets = stack_buckets * 2;
+    Stack **table = calloc(buckets, sizeof(Stack *));
+    for (size_t i = 0; i < stack_buckets; i++) {
+        Stack *stack = stack_table[i];
+        while (stack != NULL) {
+            Stack *next = stack->next;
+            stack->next = table[stack->hash % buckets];
+            table[stack->hash % buckets] = stack;
+            stack = next;
+        }
+    }
+    free(stack_table);
+    stack_table = table;
+    stack_buckets = buckets;
+}
+
+// Counts the ticks since the last time against the shadow stack as it is now
+void recordTicks() {
+    size_t ticks = pending_ticks;
+    pending_ticks = 0; // a tick that lands between these two lines is lost
+    sample_count = sample_count + ticks;
+
+    size_t start = shadow_depth > PROFILE_MAX_DEPTH ? shadow_depth - PROFILE_MAX_DEPTH : 0;
+    SchemeItem **names = shadow_stack + start;
+    int depth = shadow_depth - start;
+    bool truncated = start > 0;
+    uint64_t hash = hashStack(names, depth, truncated);
+
+    Stack *stack = stack_table[hash % stack_buckets];
+    while (stack != NULL) {
+        if (stack->hash == hash && stack->depth == depth && stack->truncated == truncated &&
+            memcmp(stack->names, names, depth * sizeof(SchemeItem *)) == 0) {
+            stack->count = stack->count + ticks;
+            return;
+        }
+        stack = stack->next;
+    }
+
+    if (stack_count >= stack_buckets) {
+        growStackTable();
+    }
+    stack = malloc(sizeof(Stack));
+    stack->names = malloc((depth > 0 ? depth : 1) * sizeof(SchemeItem *));
+    memcpy(stack->names, names, depth * sizeof(SchemeItem *));
+    stack->depth = depth;
+    stack->truncated = truncated;
+    stack->count = ticks;
+    stack->hash = hash;
+    stack->next = stack_table[hash % stack_buckets];
+    stack_table[hash % stack_buckets] = stack;
+    stack_count++;
+}
+
+// Pushes a closure on the shadow stack
+void profileEnter(SchemeItem *closure) {
+    if (!profiling) {
+        return;
+    }
+    if (pending_ticks > 0) {
+        recordTicks();
+    }
+    if (shadow_depth == shadow_capacity) {
+        shadow_capacity = shadow_capacity * 2;
+        shadow_stack = realloc(shadow_stack, shadow_capacity * sizeof(SchemeItem *));
+    }
+    shadow_stack[shadow_depth++] = closure->name;
+}
+
+// Replaces the closure on top of the shadow stack, for a tail call
+void profileReplace(SchemeItem *closure) {
+    if (!profiling) {
+        return;
+    }
+    if (pending_ticks > 0) {
+        recordTicks();
+    }
+    if (shadow_depth == 0) {
+        profileEnter(closure);
+        return;
+    }
+    shadow_stack[shadow_depth - 1] = closure->name;
+}
+
+// Pops the closure on top of the shadow stack
+void profileLeave() {
+    if (!profiling) {
+        return;
+    }
+    if (pending_ticks > 0) {
+        recordTicks();
+    }
+    if (shadow_depth > 0) {
+        shadow_depth--;
+    }
+}
+
+// Returns the name a procedure is reported by
+const char *procedureName(SchemeItem *name) {
+    return name == NULL ? "lambda" : name->s;
+}
+
+// Finds the tally for a procedure (callee alone) or a caller and callee pair in
+// an open addressed table with room for capacity of them
+Tally *findTally(Tally *tallies, size_t capacity, SchemeItem *caller, SchemeItem *callee) {
+    size_t index = (((uintptr_t)caller * 31) ^ (uintptr_t)callee) % capacity;
+    while (tallies[index].used && (tallies[index].caller != caller || tallies[index].callee != callee)) {
+        index = (index + 1) % capacity;
+    }
+    tallies[index].used = true;
+    tallies[index].caller = caller;
+    tallies[index].callee = callee;
+    return &tallies[index];
+}
+
+// Orders tallies by self samples, then by total, most first
+int compareSelf(const void *a, const void *b) {
+    const Tally *first = a;
+    const Tally *second = b;
+    if (first->self != second->self) {
+        return first->self < second->self ? 1 : -1;
+    }
+    if (first->total != second->total) {
+        return first->total < second->total ? 1 : -1;
+    }
+    return 0;
+}
+
+// Orders tallies by total samples, most first
+int compareTotal(const void *a, const void *b) {
+    const Tally *first = a;
+    const Tally *second = b;
+    if (first->total != second->total) {
+        return first->total < second->total ? 1 : -1;
+    }
+    return 0;
+}
+
+// Moves the used tallies to the front of the table, and returns how many there are
+size_t packTallies(Tally *tallies, size_t capacity) {
+    size_t count = 0;
+    for (size_t i = 0; i < capacity; i++) {
+        if (tallies[i].used) {
+            tallies[count++] = tallies[i];
+        }
+    }
+    return count;
+}
+
+// Returns count as a percentage of all samples
+double percent(size_t count) {
+    return sample_count == 0 ? 0.0 : 100.0 * count / sample_count;
+}
+
+// Writes every stack to the folded stacks file
+void writeFolded() {
+    FILE *file = fopen(folded_path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "profile: can't write %s\n", folded_path);
+        return;
+    }
+    for (size_t i = 0; i < stack_buckets; i++) {
+        for (Stack *stack = stack_table[i]; stack != NULL; stack = stack->next) {
+            if (stack->depth == 0) {
+                fprintf(file, "[toplevel]");
+            } else if (stack->truncated) {
+                fprintf(file, "...;");
+            }
+            for (int j = 0; j < stack->depth; j++) {
+                fprintf(file, j == 0 ? "%s" : ";%s", procedureName(stack->names[j]));
+            }
+            fprintf(file, " %zu\n", stack->count);
+        }
+    }
+    fclose(file);
+}
+
+// Stops the timer and prints the profiles (see profile.h)
+void printProfile() {
+    if (!profiling) {
+        return;
+    }
+    struct itimerval off = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &off, NULL);
+    if (pending_ticks > 0) {
+        recordTicks();
+    }
+    profiling = false;
+
+    // A procedure's self samples are the ones it was on top of the stack for, and
+    // its total samples the ones it was anywhere in the stack for. A caller and
+    // callee pair counts the samples taken inside that call.
+    // there can't be more of either than there are names in all the stacks
+    size_t capacity = 1;
+    for (size_t i = 0; i < stack_buckets; i++) {
+        for (Stack *stack = stack_table[i]; stack != NULL; stack = stack->next) {
+            capacity = capacity + 2 * stack->depth;
+        }
+    }
+    Tally *procedures = calloc(capacity, sizeof(Tally));
+    Tally *calls = calloc(capacity, sizeof(Tally));
+    size_t toplevel = 0;
+
+    size_t serial = 0;
+    for (size_t i = 0; i < stack_buckets; i++) {
+        for (Stack *stack = stack_table[i]; stack != NULL; stack = stack->next) {
+            serial++;
+            if (stack->depth == 0) {
+                toplevel = toplevel + stack->count;
+                continue;
+            }
+            findTally(procedures, capacity, NULL, stack->names[stack->depth - 1])->self += stack->count;
+            for (int j = 0; j < stack->depth; j++) {
+                Tally *procedure = findTally(procedures, capacity, NULL, stack->names[j]);
+                if (procedure->last_stack != serial) {
+                    procedure->total = procedure->total + stack->count;
+                    procedure->last_stack = serial;
+                }
+                if (j > 0) {
+                    Tally *call = findTally(calls, capacity, stack->names[j - 1], stack->names[j]);
+                    if (call->last_stack != serial) {
+                        call->total = call->total + stack->count;
+                        call->last_stack = serial;
+                    }
+                }
+            }
+        }
+    }
+
+    size_t procedure_count = packTallies(procedures, capacity);
+    size_t call_count = packTallies(calls, capacity);
+    qsort(procedures, procedure_count, sizeof(Tally), compareSelf);
+    qsort(calls, call_count, sizeof(Tally), compareTotal);
+
+    fprintf(stderr, "profile: %zu samples, %d us of CPU time apart\n", sample_count, PROFILE_INTERVAL);
+    fprintf(stderr, "%14s %14s  procedure\n", "self", "total");
+    if (toplevel > 0) {
+        fprintf(stderr, "%7zu %5.1f%% %7zu %5.1f%%  [toplevel]\n", toplevel, percent(toplevel), toplevel,
+                percent(toplevel));
+    }
+    for (size_t i = 0; i < procedure_count && i < PROFILE_ROWS; i++) {
+        fprintf(stderr, "%7zu %5.1f%% %7zu %5.1f%%  %s\n", procedures[i].self, percent(procedures[i].self),
+                procedures[i].total, percent(procedures[i].total), procedureName(procedures[i].callee));
+    }
+    if (call_count > 0) {
+        fprintf(stderr, "%14s  caller -> callee\n", "total");
+    }
+    for (size_t i = 0; i < call_count && i < PROFILE_ROWS; i++) {
+        fprintf(stderr, "%7zu %5.1f%%  %s -> %s\n", calls[i].total, percent(calls[i].total),
+                procedureName(calls[i].caller), procedureName(calls[i].callee));
+    }
+
+    if (folded_path != NULL) {
+        writeFolded();
+    }
+
+    free(procedures);
+    free(calls);
+    for (size_t i = 0; i < stack_buckets; i++) {
+        Stack *stack = stack_table[i];
+        while (stack != NULL) {
+            Stack *next = stack->next;
+            free(stack->names);
+            free(stack);
+            stack = next;
+        }
+    }
+    free(stack_table);
+    free(shadow_stack);
+}
@@ -0,0 +1,33 @@
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _PROFILE
+#define _PROFILE
+
+// A sampling profiler for Scheme procedures (see --profile). While it runs, the
+// evaluator and the VM keep a shadow stack of the closures that are active, each
+// named by the define, let or letrec that made it. A CPU timer ticks every
+// millisecond, and the stack as it was at each tick is counted.
+//
+// The signal handler only counts the tick. The stack is recorded the next time
+// it changes (or when the profile is printed), which is still the stack the tick
+// landed in, since nothing else can change it in between.
+
+// Starts the timer. If folded_path isn't NULL, the samples are also written there
+// as folded stacks ("outer;inner;innermost COUNT" lines) for flamegraph.pl.
+void profileStart(const char *folded_path);
+
+// A call of a closure: pushes it on the shadow stack
+void profileEnter(SchemeItem *closure);
+
+// A tail call of a closure: it takes the place of the one on top of the stack
+void profileReplace(SchemeItem *closure);
+
+// A return from the closure on top of the stack
+void profileLeave();
+
+// Stops the timer and prints the flat, inclusive and caller profiles to stderr
+// (and writes the folded stacks). main runs this at exit.
+void printProfile();
+
+#endif
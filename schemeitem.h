@@ -1,44 +1,186 @@
 #ifndef _SCHEMEITEM
 #define _SCHEMEITEM
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
 typedef enum {
    INT_TYPE, DOUBLE_TYPE, STR_TYPE, CONS_TYPE, EMPTY_TYPE, PTR_TYPE,
    OPEN_TYPE, CLOSE_TYPE, BOOL_TYPE, SYMBOL_TYPE, SINGLEQUOTE_TYPE,
    VOID_TYPE, CLOSURE_TYPE, PRIMITIVE_TYPE, UNSPECIFIED_TYPE,
-    
+
+   // Nodes produced by the analysis pass (see analyzer.h)
+   LOCAL_TYPE, BOXED_TYPE, GLOBAL_TYPE, LAMBDA_TYPE, MAKEBOX_TYPE, FOLDED_TYPE,
+
+   // Compiled code from the bytecode compiler (see vm.h)
+   CODE_TYPE,
+
+   // Output ports (see port.h)
+   PORT_TYPE,
+   // Integers too big for a fixnum (see number.h)
+   BIGNUM_TYPE,
+   // Vectors (see Vector below), and the #( token that starts a literal one
+   VECTOR_TYPE, OPENVECTOR_TYPE,
+   // Hash tables (see hashtable.h)
+   HASHTABLE_TYPE,
+   // The cell holding a variable that closures capture and set! changes
+   BOX_TYPE,
+
    // Types below are only for bonus work
    DOT_TYPE, OPENBRACKET_TYPE, CLOSEBRACKET_TYPE
 } itemType;
 
+// Keywords that eval handles itself instead of applying a procedure. Each
+// keyword's interned symbol carries its tag, so eval can dispatch on it
+// without comparing names.
+typedef enum {
+   NOT_SPECIAL, IF_FORM, LET_FORM, QUOTE_FORM, DEFINE_FORM, LAMBDA_FORM,
+   LETREC_FORM, SET_FORM, BEGIN_FORM, COND_FORM, AND_FORM, OR_FORM,
+   SPECIAL_FORM_COUNT
+} specialForm;
+
+// Integers, booleans, the empty list, void and unspecified are never allocated.
+// They are encoded in the SchemeItem pointer itself, so they must only be looked
+// at through typeOf and the functions below, never dereferenced.
 typedef struct SchemeItem {
     itemType type;
     union {
-        int i;
         double d;
-        char *s;
+        struct {
+            char *s;
+            specialForm form; // For SYMBOL_TYPE
+        };
+        struct {
+            char *text;      // a GC_RAW buffer, which substrings share
+            uint32_t offset; // where in text the string starts
+            uint32_t length;
+            uint32_t hash;   // 0 until it is first needed
+        }; // For STR_TYPE (see schemestring.h)
         struct {
             struct SchemeItem *car;
             struct SchemeItem *cdr;
         }; // For CONS_TYPE
         struct {
-            struct SchemeItem *paramNames;
-            struct SchemeItem *functionCode;
-            struct Frame *frame;
+            struct SchemeItem *symbol;
+            int depth;
+            int index;
+            struct SchemeItem *binding; // a global's (symbol . value) cell, once it has been found
+        }; // For LOCAL_TYPE, BOXED_TYPE, GLOBAL_TYPE and MAKEBOX_TYPE (only globals have a binding)
+        struct {
+            struct SchemeItem *body;
+            struct SchemeItem *captures; // where each captured variable is, where the lambda is
+            int paramCount;
+            int frameSize : 31; // parameters first, then internal defines
+            unsigned rest : 1;  // the last parameter collects any remaining arguments
+        }; // For LAMBDA_TYPE
+        struct {
+            struct SchemeItem *lambda; // a LAMBDA_TYPE node, or a CODE_TYPE item under the VM
+            struct Frame *frame;       // the captured variables, or NULL if there are none
+            struct SchemeItem *name; // the variable it was defined as, or NULL (see profile.h)
         }; // For CLOSURE_TYPE
+        struct {
+            struct SchemeItem *entries; // a vector of keys and values, side by side
+            int count;        // live entries
+            int used;         // live entries plus deleted ones
+            uint32_t epoch;   // the minor collection count when young_keys was last set
+            bool equal;       // compares keys with equal? rather than eq?
+            bool young_keys;  // some key's address may still change (eq? tables only)
+        }; // For HASHTABLE_TYPE
+        struct {
+            struct SchemeItem *folded;   // the value the call came out to
+            struct SchemeItem *original; // the call itself, for once a primitive has been redefined
+            size_t redefinitions;        // how many primitives had been redefined when it was folded
+        }; // For FOLDED_TYPE (see analyzer.h)
+        struct SchemeItem *contents; // For BOX_TYPE: the variable's value, NULL until it is defined
         void *ptr;
-        // A primitive style function; just a pointer to it, with the right
-        // signature (pf = primitive function)
-        struct SchemeItem *(*pf)(struct SchemeItem *);
+        struct {
+            // A primitive style function; just a pointer to it, with the right
+            // signature (pf = primitive function)
+            struct SchemeItem *(*pf)(struct SchemeItem *);
+            // For a primitive with no side effects, whether it would return
+            // normally for these arguments, so it can be called while analyzing
+            // (NULL for the rest)
+            bool (*canFold)(struct SchemeItem *);
+            // For the primitives called most, the same function taking its
+            // arguments as an array instead of a list, so that calling it needs
+            // no allocation (NULL for the rest). It must not call back into
+            // eval or the VM, since the array may be the VM's own stack.
+            struct SchemeItem *(*fixed)(struct SchemeItem **args, int count);
+        }; // For PRIMITIVE_TYPE
     };
 } SchemeItem;
 
-// A frame is a linked list of bindings, and a pointer to another frame.  A
-// binding is a variable name (represented as a string), and a pointer to the
-// Object it is bound to. Specifically how you implement the list of bindings
-// is up to you.
+// A vector keeps its elements in one block right after its length, so indexing
+// is a single load. It is allocated as a GC_ITEM, but only the type lines up with
+// SchemeItem, so a VECTOR_TYPE item must be looked at through this struct. A
+// vector read from a literal is constant: vector-set! refuses to change it.
+typedef struct Vector {
+    itemType type;
+    bool constant;
+    long length;
+    struct SchemeItem *items[];
+} Vector;
+
+// Heap items are at least 8 byte aligned, so the low bits of a real pointer are
+// always 0. A fixnum (INT_TYPE) has its low bit set and its value in the rest of
+// the word. The other immediates are (n << 3) | 2.
+#define FIXNUM_TAG 1
+#define IMMEDIATE_TAG 2
+#define IMMEDIATE(n) ((SchemeItem *)(uintptr_t)(((n) << 3) | IMMEDIATE_TAG))
+
+#define SCHEME_FALSE IMMEDIATE(0)
+#define SCHEME_TRUE IMMEDIATE(1)
+#define SCHEME_EMPTY IMMEDIATE(2)
+#define SCHEME_VOID IMMEDIATE(3)
+#define SCHEME_UNSPECIFIED IMMEDIATE(4)
+
+// Returns whether item is encoded in the pointer rather than allocated
+static inline bool isImmediate(SchemeItem *item) {
+    return ((uintptr_t)item & (FIXNUM_TAG | IMMEDIATE_TAG)) != 0;
+}
+
+// Returns the type of any item, immediate or not
+static inline itemType typeOf(SchemeItem *item) {
+    uintptr_t bits = (uintptr_t)item;
+    if (bits & FIXNUM_TAG) {
+        return INT_TYPE;
+    }
+    if (bits & IMMEDIATE_TAG) {
+        static const itemType immediate_types[] = {
+            BOOL_TYPE, BOOL_TYPE, EMPTY_TYPE, VOID_TYPE, UNSPECIFIED_TYPE
+        };
+        return immediate_types[bits >> 3];
+    }
+    return item->type;
+}
+
+// Converts between fixnums and C integers
+static inline SchemeItem *makeFixnum(long value) {
+    return (SchemeItem *)(((uintptr_t)value << 1) | FIXNUM_TAG);
+}
+
+static inline long fixnumValue(SchemeItem *item) {
+    return (intptr_t)item >> 1;
+}
+
+// Returns the boolean immediate for a C bool
+static inline SchemeItem *makeBool(bool value) {
+    return value ? SCHEME_TRUE : SCHEME_FALSE;
+}
+
+// A frame holds the values of the variables of one scope (a lambda call, let
+// or letrec), and a pointer to the enclosing frame. The analysis pass gives
+// every variable its slot, so frames don't store names at all. A slot is NULL
+// until its variable is bound.
+//
+// A closure's captured variables are a frame too, with no parent, and it is the
+// parent of every frame made for a call to the closure. So a closure keeps
+// alive only the variables it uses, not every frame around the lambda.
 typedef struct Frame {
-    SchemeItem *bindings;
     struct Frame *parent;
+    int size;
+    SchemeItem *slots[];
 } Frame;
 
 #endif
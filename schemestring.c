@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "gc.h"
+#include "schemestring.h"
+
+// Strings can't be longer than this, so their length fits in the item
+#define STRING_MAX_LENGTH (1L << 30)
+
+// Reports a string too long to make
+void stringTooLong() {
+    printf("Evaluation error: string too long\n");
+    texit(1);
+}
+
+// Makes a string item for length bytes of a text buffer, starting at offset
+SchemeItem *makeStringItem(char *text, size_t offset, size_t length) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(text);
+    SchemeItem *string = makeItem(STR_TYPE);
+    gcRestoreRoots(roots);
+
+    string->text = text;
+    string->offset = offset;
+    string->length = length;
+    return string;
+}
+
+// Makes a string from a copy of some text (see schemestring.h)
+SchemeItem *makeString(const char *text, size_t length) {
+    if (length > STRING_MAX_LENGTH) {
+        stringTooLong();
+    }
+    char *buffer = gcAlloc(GC_RAW, length);
+    memcpy(buffer, text, length);
+    return makeStringItem(buffer, 0, length);
+}
+
+// Makes a substring that shares the original's text
+SchemeItem *substring(SchemeItem *string, size_t start, size_t end) {
+    size_t roots = gcSaveRoots();
+    GC_ROOT(string);
+    SchemeItem *slice = makeItem(STR_TYPE);
+    gcRestoreRoots(roots);
+
+    slice->text = string->text;
+    slice->offset = string->offset + start;
+    slice->length = end - start;
+    return slice;
+}
+
+// Appends a list of strings. Their lengths are added up first, so the new text is
+// allocated once at its final size.
+SchemeItem *stringAppend(SchemeItem *strings) {
+    size_t total = 0;
+    for (SchemeItem *current = strings; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        if (typeOf(current->car) != STR_TYPE) {
+            printf("Evaluation error: not a string\n");
+            texit(1);
+        }
+        total = total + current->car->length;
+    }
+    if (total > STRING_MAX_LENGTH) {
+        stringTooLong();
+    }
+
+    size_t roots = gcSaveRoots();
+    GC_ROOT(strings);
+    char *buffer = gcAlloc(GC_RAW, total);
+    gcRestoreRoots(roots);
+
+    size_t length = 0;
+    for (SchemeItem *current = strings; typeOf(current) == CONS_TYPE; current = current->cdr) {
+        memcpy(buffer + length, stringChars(current->car), current->car->length);
+        length = length + current->car->length;
+    }
+    return makeStringItem(buffer, 0, length);
+}
+
+// Returns the string's FNV-1a hash, kept in the string once it is known. A hash
+// that comes out as 0 is stored as 1, since 0 means it hasn't been computed.
+uint32_t stringHash(SchemeItem *string) {
+    if (string->hash == 0) {
+        uint32_t hash = 2166136261u;
+        char *chars = stringChars(string);
+        for (uint32_t i = 0; i < string->length; i++) {
+            hash = (hash ^ (unsigned char)chars[i]) * 16777619u;
+        }
+        string->hash = hash == 0 ? 1 : hash;
+    }
+    return string->hash;
+}
+
+// Returns whether two strings are the same. Strings whose hashes are already
+// known and differ can't be.
+bool stringEqual(SchemeItem *left, SchemeItem *right) {
+    if (left->length != right->length) {
+        return false;
+    }
+    if (left->hash != 0 && right->hash != 0 && left->hash != right->hash) {
+        return false;
+    }
+    return memcmp(stringChars(left), stringChars(right), left->length) == 0;
+}
+
+// Compares two strings byte by byte; a string sorts after any prefix of it
+int stringCompare(SchemeItem *left, SchemeItem *right) {
+    uint32_t shorter = left->length < right->length ? left->length : right->length;
+    int order = memcmp(stringChars(left), stringChars(right), shorter);
+    if (order != 0) {
+        return order < 0 ? -1 : 1;
+    }
+    return (left->length > right->length) - (left->length < right->length);
+}
+
+// Returns a null terminated copy of the string, in the arena
+char *stringToC(SchemeItem *string) {
+    char *copy = talloc(string->length + 1);
+    memcpy(copy, stringChars(string), string->length);
+    copy[string->length] = '\0';
+    return copy;
+}
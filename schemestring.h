@@ -0,0 +1,50 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _SCHEMESTRING
+#define _SCHEMESTRING
+
+// Strings. A STR_TYPE item is a slice (offset and length) of a text buffer, which
+// is a GC_RAW object of its own. Strings are never changed once made, so a
+// substring just points into the same buffer instead of copying it, and the
+// length is always known. The text isn't null terminated.
+//
+// A substring keeps the whole of its buffer alive; string-append copies, so
+// appending to a slice of a big string frees the rest of it.
+//
+// The functions that make strings can collect, so callers must root anything
+// else they hold.
+
+// Returns the first character of a string. The pointer is only good until the
+// next allocation, which may move the text.
+static inline char *stringChars(SchemeItem *string) {
+    return string->text + string->offset;
+}
+
+// Makes a string holding a copy of length bytes of text. text must not be in the
+// collected heap (use substring to copy part of another string).
+SchemeItem *makeString(const char *text, size_t length);
+
+// Makes the string of the characters of string from start up to end, sharing its text
+SchemeItem *substring(SchemeItem *string, size_t start, size_t end);
+
+// Makes one string of all the strings in a list, copied into a single new buffer
+SchemeItem *stringAppend(SchemeItem *strings);
+
+// Returns the string's hash, computing it the first time. Equal strings hash the
+// same. Never allocates.
+uint32_t stringHash(SchemeItem *string);
+
+// Returns whether two strings have the same characters. Never allocates.
+bool stringEqual(SchemeItem *left, SchemeItem *right);
+
+// Returns -1, 0 or 1 as left sorts before, the same as or after right, byte by
+// byte. Never allocates.
+int stringCompare(SchemeItem *left, SchemeItem *right);
+
+// Returns a null terminated copy of a string, in the talloc arena
+char *stringToC(SchemeItem *string);
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "gc.h"
+#include "stats.h"
+
+#ifdef STATS
+
+// Allocations are counted in buckets by requested size: up to 8 bytes, 16, 32, ...
+// and everything over the last one together
+#define SIZE_BUCKETS 12
+
+size_t eval_counts[CLOSEBRACKET_TYPE + 1];
+size_t form_counts[SPECIAL_FORM_COUNT];
+size_t closure_calls = 0;
+size_t primitive_calls = 0;
+size_t frames_made = 0;
+size_t frame_slots = 0;
+size_t local_lookups = 0;
+size_t local_depth = 0;
+size_t global_lookups = 0;
+size_t alloc_calls[SIZE_BUCKETS];
+size_t alloc_bytes[SIZE_BUCKETS];
+size_t talloc_calls[SIZE_BUCKETS];
+size_t talloc_bytes[SIZE_BUCKETS];
+
+// Names for the eval counts, by node type
+const char *type_names[CLOSEBRACKET_TYPE + 1] = {
+    [INT_TYPE] = "integer", [BIGNUM_TYPE] = "bignum", [DOUBLE_TYPE] = "double", [STR_TYPE] = "string",
+    [VECTOR_TYPE] = "vector", [CONS_TYPE] = "call", [BOOL_TYPE] = "boolean", [LOCAL_TYPE] = "local variable",
+    [BOXED_TYPE] = "boxed variable", [GLOBAL_TYPE] = "global variable", [LAMBDA_TYPE] = "lambda",
+    [MAKEBOX_TYPE] = "box", [FOLDED_TYPE] = "folded call"
+};
+
+const char *form_names[SPECIAL_FORM_COUNT] = {
+    [IF_FORM] = "if", [LET_FORM] = "let", [QUOTE_FORM] = "quote", [DEFINE_FORM] = "define",
+    [LAMBDA_FORM] = "lambda", [LETREC_FORM] = "letrec", [SET_FORM] = "set!",
+    [BEGIN_FORM] = "begin", [COND_FORM] = "cond", [AND_FORM] = "and", [OR_FORM] = "or"
+};
+
+void statsEval(itemType type) {
+    eval_counts[type]++;
+}
+
+void statsEvalForm(specialForm form) {
+    form_counts[form]++;
+}
+
+void statsApply(bool closure) {
+    if (closure) {
+        closure_calls++;
+    } else {
+        primitive_calls++;
+    }
+}
+
+void statsFrame(int size) {
+    frames_made++;
+    frame_slots = frame_slots + size;
+}
+
+void statsLocalLookup(int depth) {
+    local_lookups++;
+    local_depth = local_depth + depth;
+}
+
+void statsGlobalLookup() {
+    global_lookups++;
+}
+
+// Counts a request for size bytes in its bucket of calls and bytes
+void countSize(size_t *calls, size_t *bytes, size_t size) {
+    int bucket = 0;
+    while (bucket < SIZE_BUCKETS - 1 && size > ((size_t)8 << bucket)) {
+        bucket++;
+    }
+    calls[bucket]++;
+    bytes[bucket] = bytes[bucket] + size;
+}
+
+void statsAlloc(size_t size) {
+    countSize(alloc_calls, alloc_bytes, size);
+}
+
+void statsTalloc(size_t size) {
+    countSize(talloc_calls, talloc_bytes, size);
+}
+
+// Returns total / count, or 0 if nothing was counted
+double average(size_t total, size_t count) {
+    return count == 0 ? 0.0 : (double)total / count;
+}
+
+// Prints the non-empty buckets of a histogram made by countSize
+void printSizes(const char *title, size_t *calls, size_t *bytes) {
+    fprintf(stderr, "%s:\n", title);
+    for (int bucket = 0; bucket < SIZE_BUCKETS; bucket++) {
+        if (calls[bucket] == 0) {
+            continue;
+        }
+        if (bucket == SIZE_BUCKETS - 1) {
+            fprintf(stderr, "  > %-8zu %zu calls, %zu bytes\n", (size_t)8 << (bucket - 1),
+                    calls[bucket], bytes[bucket]);
+        } else {
+            fprintf(stderr, "  <= %-7zu %zu calls, %zu bytes\n", (size_t)8 << bucket,
+                    calls[bucket], bytes[bucket]);
+        }
+    }
+}
+
+// Prints every counter to stderr
+void printStats() {
+    // a special form is counted as a CONS_TYPE node too, so it's taken back out of
+    // the calls
+    for (int form = 0; form < SPECIAL_FORM_COUNT; form++) {
+        eval_counts[CONS_TYPE] = eval_counts[CONS_TYPE] - form_counts[form];
+    }
+
+    fprintf(stderr, "eval calls by node type:\n");
+    for (int type = 0; type <= CLOSEBRACKET_TYPE; type++) {
+        if (eval_counts[type] > 0) {
+            fprintf(stderr, "  %-20s %zu\n", type_names[type] ? type_names[type] : "other", eval_counts[type]);
+        }
+    }
+    for (int form = 0; form < SPECIAL_FORM_COUNT; form++) {
+        if (form_counts[form] > 0) {
+            fprintf(stderr, "  %-20s %zu\n", form_names[form], form_counts[form]);
+        }
+    }
+
+    fprintf(stderr, "calls: %zu closure, %zu primitive\n", closure_calls, primitive_calls);
+    fprintf(stderr, "frames made: %zu (%.2f slots on average)\n", frames_made, average(frame_slots, frames_made));
+    fprintf(stderr, "local lookups: %zu (%.2f frames out on average)\n",
+            local_lookups, average(local_depth, local_lookups));
+    fprintf(stderr, "global table lookups: %zu\n", global_lookups);
+
+    printSizes("heap allocations by requested size", alloc_calls, alloc_bytes);
+    printSizes("talloc calls (permanent arena) by requested size", talloc_calls, talloc_bytes);
+
+    fprintf(stderr, "heap: %zu objects allocated (%zu bytes), peak old generation %zu bytes\n",
+            gcAllocations(), gcAllocatedBytes(), gcPeakHeapBytes());
+}
+
+#endif
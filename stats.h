@@ -0,0 +1,44 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _STATS
+#define _STATS
+
+// Runtime counters for --stats. They are only compiled in when STATS is defined
+// (just build-stats). Otherwise STAT expands to nothing, so the counting calls
+// wrapped in it cost nothing at all.
+#ifdef STATS
+#define STAT(call) call
+#else
+#define STAT(call)
+#endif
+
+// An eval of a node of the given type (a CONS_TYPE node is a procedure call)
+void statsEval(itemType type);
+
+// An eval of a special form
+void statsEvalForm(specialForm form);
+
+// A call of a closure, or of a primitive
+void statsApply(bool closure);
+
+// A frame with size slots made by makeFrame
+void statsFrame(int size);
+
+// A lookup of a local variable depth frames out
+void statsLocalLookup(int depth);
+
+// A lookup in the global table (a reference whose binding isn't cached yet, or a define)
+void statsGlobalLookup();
+
+// An allocation of size bytes in the collected heap (gcAlloc and gcAllocOld)
+void statsAlloc(size_t size);
+
+// A talloc call for size bytes, in the permanent arena
+void statsTalloc(size_t size);
+
+// Prints every counter to stderr
+void printStats();
+
+#endif
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <string.h>
+#include "schemeitem.h"
+#include "talloc.h"
+#include "gc.h"
+
+// The intern table: open addressing with linear probing, kept at most half full.
+// It is allocated with talloc, so a table that has been outgrown is simply left
+// behind in the arena.
+SchemeItem **symbol_table = NULL;
+size_t symbol_capacity = 0;
+size_t symbol_count = 0;
+
+// FNV-1a hash of the length bytes of a symbol name
+uint64_t hashName(char *name, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Finds the slot where the name (length bytes, not necessarily null terminated)
+// lives, or the empty slot where it should go
+SchemeItem **findSlot(SchemeItem **table, size_t capacity, char *name, size_t length) {
+    size_t index = hashName(name, length) & (capacity - 1);
+    while (table[index] != NULL
+           && (memcmp(table[index]->s, name, length) != 0 || table[index]->s[length] != '\0')) {
+        index = (index + 1) & (capacity - 1);
+    }
+    return &table[index];
+}
+
+// Doubles the size of the table, rehashing every symbol into the new one
+void growSymbolTable() {
+    size_t capacity = symbol_capacity == 0 ? 256 : symbol_capacity * 2;
+    SchemeItem **table = talloc(capacity * sizeof(SchemeItem *));
+    memset(table, 0, capacity * sizeof(SchemeItem *));
+
+    for (size_t i = 0; i < symbol_capacity; i++) {
+        if (symbol_table[i] != NULL) {
+            char *name = symbol_table[i]->s;
+            *findSlot(table, capacity, name, strlen(name)) = symbol_table[i];
+        }
+    }
+
+    symbol_table = table;
+    symbol_capacity = capacity;
+}
+
+// Looks up the name in the intern table, adding a new symbol (with its own null
+// terminated copy of the name) if it isn't there yet
+SchemeItem *internLength(char *name, size_t length) {
+    if ((symbol_count + 1) * 2 > symbol_capacity) {
+        growSymbolTable();
+    }
+
+    SchemeItem **slot = findSlot(symbol_table, symbol_capacity, name, length);
+    if (*slot == NULL) {
+        SchemeItem *symbol = gcAllocPermanent(GC_ITEM, sizeof(SchemeItem));
+        symbol->type = SYMBOL_TYPE;
+        symbol->s = talloc(length + 1);
+        memcpy(symbol->s, name, length);
+        symbol->s[length] = '\0';
+
+        *slot = symbol;
+        symbol_count++;
+    }
+    return *slot;
+}
+
+// Looks up a null terminated name
+SchemeItem *intern(char *name) {
+    return internLength(name, strlen(name));
+}
@@ -0,0 +1,17 @@
+#include <stddef.h>
+#include "schemeitem.h"
+
+#ifndef _SYMBOLS
+#define _SYMBOLS
+
+// Returns the one SYMBOL_TYPE item for the given name, creating it the first
+// time the name is seen. Since every symbol goes through here, two symbols
+// have the same name exactly when they are the same pointer. Symbols are
+// permanent: the garbage collector never moves or frees them.
+SchemeItem *intern(char *name);
+
+// The same, for a name that is length bytes long and needn't be null terminated
+// (a slice of the reader's input buffer)
+SchemeItem *internLength(char *name, size_t length);
+
+#endif
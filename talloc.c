@@ -1,44 +1,126 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <stdlib.h>
+#include <stdint.h>
 #include "schemeitem.h"
-SchemeItem *active_list = NULL;
+#include "gc.h"
+#include "port.h"
+#include "stats.h"
+#include "profile.h"
+
+// Size of a regular arena chunk. Requests bigger than a quarter of this get a
+// chunk of their own, so one large allocation never wastes the tail of a chunk
+// that small objects are still being bumped out of.
+#define CHUNK_SIZE (1 << 20)
+#define LARGE_REQUEST (CHUNK_SIZE / 4)
+
+// A chunk of arena memory. The usable bytes follow the header directly.
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t size;
+    size_t used;
+} Chunk;
+
+// Header size rounded up so the first object in a chunk is 16 byte aligned
+#define CHUNK_HEADER ((sizeof(Chunk) + 15) & ~(size_t)15)
+
+Chunk *current_chunk = NULL; // chunk that small requests are bumped out of
+Chunk *full_chunks = NULL;   // every other chunk, kept only so tfree can find them
+
+size_t bytes_reserved = 0;
+size_t bytes_used = 0;
+
+// Rounds a request up to its size class. Everything is a multiple of 8 bytes,
+// and anything 16 bytes or larger is a multiple of 16 so that it can hold any
+// scalar type.
+size_t sizeClass(size_t size) {
+    if (size <= 8) {
+        return 8;
+    }
+    return (size + 15) & ~(size_t)15;
+}
+
+// Mallocs a new chunk able to hold at least size bytes
+Chunk *newChunk(size_t size) {
+    Chunk *chunk = malloc(CHUNK_HEADER + size);
+    if (chunk == NULL) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    bytes_reserved = bytes_reserved + CHUNK_HEADER + size;
+    return chunk;
+}
 
-// Allocates memory of desired size using malloc and returns its ponter
-// Additionally, creates a cell that is added to a global linked list which tracks memory
+// Allocates memory of desired size by bumping a pointer through the current chunk.
+// When the chunk runs out, it is retired and a fresh one is started. Large requests
+// get a dedicated chunk so the current one can keep being used.
 void *talloc(size_t size) {
-    SchemeItem *pointer = malloc(size);
+    STAT(statsTalloc(size));
+    size_t rounded = sizeClass(size);
+    bytes_used = bytes_used + rounded;
+
+    if (rounded > LARGE_REQUEST) {
+        Chunk *chunk = newChunk(rounded);
+        chunk->used = rounded;
+        chunk->next = full_chunks;
+        full_chunks = chunk;
+        return (char *)chunk + CHUNK_HEADER;
+    }
 
-    SchemeItem *node = malloc(sizeof(SchemeItem));
-    node->type = PTR_TYPE;
-    node->ptr = pointer;
-    node->cdr = active_list;
+    if (current_chunk == NULL || current_chunk->size - current_chunk->used < rounded) {
+        if (current_chunk != NULL) {
+            current_chunk->next = full_chunks;
+            full_chunks = current_chunk;
+        }
+        current_chunk = newChunk(CHUNK_SIZE);
+    }
 
-    active_list = node;
+    void *pointer = (char *)current_chunk + CHUNK_HEADER + current_chunk->used;
+    current_chunk->used = current_chunk->used + rounded;
 
     // just return the new memory pointer
     return pointer;
 }
 
-// Frees the memory of the pointers in the global linked list
-// and the memory locations they are pointing to
+// Frees every chunk in the arena, which releases everything talloc ever returned,
+// and then the collector's heap
 void tfree() {
-    while (active_list != NULL) {
-        SchemeItem *next = active_list->cdr;
-
-        SchemeItem *current = active_list->ptr;
+    gcFreeHeap();
 
-        free(current);
+    if (current_chunk != NULL) {
+        free(current_chunk);
+        current_chunk = NULL;
+    }
 
-        free(active_list);
-        active_list = next;
+    while (full_chunks != NULL) {
+        Chunk *next = full_chunks->next;
+        free(full_chunks);
+        full_chunks = next;
     }
-}
 
+    bytes_reserved = 0;
+    bytes_used = 0;
+}
 
-// Calls tfree function before terminating the program 
+// Closes the output ports (flushing them), prints the profile if there is one (it
+// needs the symbols' names) and calls tfree function before terminating the program
 void texit(int status) {
+    closeAllPorts();
+    printProfile();
     tfree();
     exit(status);
 }
+
+// Returns the number of bytes reserved from malloc across all chunks
+size_t tallocReserved() {
+    return bytes_reserved;
+}
+
+// Returns the number of bytes handed out, after rounding up to size classes
+size_t tallocUsed() {
+    return bytes_used;
+}
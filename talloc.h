@@ -4,15 +4,15 @@
 #ifndef _TALLOC
 #define _TALLOC
 
-// Replacement for malloc that stores the pointers allocated. It should store
-// the pointers in some kind of list; a linked list would do fine, but insert
-// here whatever code you'll need to do so; don't call functions in the
-// pre-existing linkedlist.h. Otherwise you'll end up with circular
-// dependencies, since you're going to modify the linked list to use talloc.
+// Replacement for malloc. Memory comes out of large chunks that are obtained
+// from malloc and handed out with a bump pointer, so most calls never reach
+// malloc at all. Individual allocations are never freed; the whole arena is
+// released at once by tfree. Don't call functions in the pre-existing
+// linkedlist.h from here, since the linked list uses talloc.
 void *talloc(size_t size);
 
-// Free all pointers allocated by talloc, as well as whatever memory you
-// allocated in lists to hold those pointers.
+// Free all chunks allocated by talloc, along with the garbage collected heap
+// (see gc.h).
 void tfree();
 
 // Replacement for the C function "exit", that consists of two lines: it calls
@@ -20,5 +20,11 @@ void tfree();
 // you can exit your program, and all memory is automatically cleaned up.
 void texit(int status);
 
-#endif
+// Total bytes talloc has reserved from malloc (the size of every chunk).
+size_t tallocReserved();
+
+// Total bytes handed out by talloc, including the padding added to round each
+// request up to its size class.
+size_t tallocUsed();
 
+#endif
@@ -0,0 +1,4 @@
+(define x 1)
+(begin (set! x 5) (+ x 1))
+(begin 1 2 3)
+(let ((y 2)) (begin (set! y (+ y 1)) y))
@@ -0,0 +1,7 @@
+(cond ((< 3 2) 1) ((< 2 3) 2) (else 3))
+(cond ((< 3 2) 1) (else 7))
+(cond (5))
+(define f (lambda (n) (cond ((equal? n 0) "zero") ((< n 0) "negative") (else "positive"))))
+(f 0)
+(f -4)
+(f 9)
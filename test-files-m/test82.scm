@@ -0,0 +1,9 @@
+(and 1 2)
+(and #f 2)
+(and)
+(or #f 3)
+(or)
+(or #f #f)
+(define x 0)
+(or #t (set! x 1))
+x
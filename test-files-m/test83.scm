@@ -0,0 +1,8 @@
+((lambda args args) 1 2)
+(define g (lambda (x) (define y (+ x 1)) (define h (lambda () (set! y (+ y 10)) y)) (h) (h)))
+(g 1)
+(define counter (let ((n 0)) (lambda () (set! n (+ n 1)) n)))
+(counter)
+(counter)
+(let ((x 1)) (let ((y 2)) (let ((z 3)) (+ x y z))))
+(letrec ((len (lambda (l) (if (null? l) 0 (+ 1 (len (cdr l))))))) (len (quote (1 2 3 4))))
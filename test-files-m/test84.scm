@@ -0,0 +1,8 @@
+(define loop (lambda (n acc) (if (equal? n 0) acc (loop (+ n -1) (+ acc 1)))))
+(loop 300000 0)
+(define count-down (lambda (n) (cond ((equal? n 0) (quote done)) (else (let ((m (+ n -1))) (begin (count-down m)))))))
+(count-down 300000)
+(define even? (lambda (n) (or (equal? n 0) (and (< 0 n) (odd? (+ n -1))))))
+(define odd? (lambda (n) (and (< 0 n) (even? (+ n -1)))))
+(even? 300001)
+(letrec ((f (lambda (n) (if (equal? n 0) 0 (f (+ n -1)))))) (f 300000))
@@ -0,0 +1,7 @@
+; each form runs before the next one is read
+(define x (quote (1 2)))
+(car x)
+''a
+(car ''b)
+(car x))
+(car x)
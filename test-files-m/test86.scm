@@ -0,0 +1,11 @@
+(display "hello")
+(newline)
+(write "hello")
+(newline)
+(display (quote (1 "two" #t 3.5)))
+(newline)
+(define s (with-output-to-string (lambda () (display "a") (write 12) (display (quote (x y))))))
+s
+(display s)
+(newline)
+(with-output-to-string (lambda () (with-output-to-string (lambda () (display 1))) (display 2)))
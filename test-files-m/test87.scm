@@ -0,0 +1,44 @@
+(+ 4611686018427387903 1)
+(- -4611686018427387904 1)
+(* 4294967296 4294967296)
+(+ 9007199254740993 0)
+123456789012345678901234567890
+-123456789012345678901234567890
+(- (+ 4611686018427387903 1) 1)
+(define fact
+  (lambda (n)
+    (if (= n 0) 1 (* n (fact (- n 1))))))
+(fact 25)
+(quotient (fact 25) (fact 23))
+(remainder 17 -5)
+(modulo 17 -5)
+(modulo -17 5)
+(modulo (- (fact 20)) 7)
+(- 5)
+(- 10 1 2 3)
+(* 1 2 3 4)
+(+ 1 2.5)
+(* 2 0.5)
+(/ 12 4)
+(/ 1 4)
+(exact->inexact 7)
+(< 1 2 3)
+(< 1 3 2)
+(>= 3 3 1)
+(= 2 2.0)
+(> (fact 30) (fact 29))
+(equal? (fact 22) (* 22 (fact 21)))
+(equal? 2 2.0)
+(integer? 2.0)
+(integer? (fact 30))
+(number? 'a)
+(zero? (- (fact 21) (fact 21)))
+(abs (- (fact 21)))
+(= 9007199254740993 9007199254740992.0)
+(< 9007199254740992.0 9007199254740993)
+(= 9007199254740992 9007199254740992.0)
+(= (* 4294967296 4294967296 4294967296) 79228162514264337593543950336.0)
+(< -0.5 0)
+(< 4611686018427387904 (/ 1.0 0.0))
+(= (/ 0.0 0.0) (/ 0.0 0.0))
+(quotient 7 0)
@@ -0,0 +1,42 @@
+;; vectors
+(define v (make-vector 5 0))
+v
+(vector-length v)
+(vector-set! v 0 'a)
+(vector-set! v 4 '(1 2))
+v
+(vector-ref v 4)
+(vector 1 "two" 3.5 #t)
+(vector)
+#(1 2 (3 4) #(5))
+'#(a b c)
+(vector-ref #(10 20 30) 2)
+(vector? #(1))
+(vector? '(1))
+(vector->list (vector 1 2 3))
+(list->vector '(x y z))
+(vector-length (make-vector 3))
+
+;; a table-driven loop: fill a vector of squares, then sum it by index
+(define squares (make-vector 100))
+(define fill
+  (lambda (i)
+    (if (< i 100)
+        (begin (vector-set! squares i (* i i)) (fill (+ i 1)))
+        #t)))
+(fill 0)
+(define sum
+  (lambda (i acc)
+    (if (= i 100) acc (sum (+ i 1) (+ acc (vector-ref squares i))))))
+(sum 0 0)
+
+;; big enough to be allocated outside the nursery
+(define big (make-vector 1000 '()))
+(define push-all
+  (lambda (i)
+    (if (< i 1000)
+        (begin (vector-set! big i (cons i (vector-ref big i))) (push-all (+ i 1)))
+        #t)))
+(push-all 0)
+(vector-ref big 999)
+(vector-ref v 5)
@@ -0,0 +1,77 @@
+;; hash tables
+(define t (make-hash-table))
+t
+(hash-table? t)
+(hash-table? '())
+(hash-table-set! t 'apple 1)
+(hash-table-set! t "pear" 2)
+(hash-table-set! t '(1 2) 3)
+(hash-table-set! t #(a b) 4)
+(hash-table-set! t 12345678901234567890123 5)
+(hash-table-set! t 2.5 6)
+(hash-table-ref t 'apple)
+(hash-table-ref t "pear")
+(hash-table-ref t (cons 1 (cons 2 '())))
+(hash-table-ref t (vector 'a 'b))
+(hash-table-ref t (+ 12345678901234567890000 123))
+(hash-table-ref t 12345678901234567890123)
+(hash-table-ref t 2.5)
+(hash-table-ref/default t 'banana 'none)
+(hash-table-ref t 'banana (lambda () 'missing))
+(hash-table-contains? t "pear")
+(hash-table-count t)
+(hash-table-set! t 'apple 10)
+(hash-table-ref t 'apple)
+(hash-table-delete! t 'apple)
+(hash-table-contains? t 'apple)
+(hash-table-count t)
+
+;; eq? tables compare keys by identity
+(define e (make-hash-table eq?))
+(define key (cons 1 2))
+(hash-table-set! e key 'found)
+(hash-table-set! e 'sym 'symbol)
+(hash-table-ref/default e key #f)
+(hash-table-ref/default e (cons 1 2) #f)
+(hash-table-ref e 'sym)
+
+;; equal? compares structure
+(equal? '(1 (2 #(3 "x"))) (cons 1 (cons (cons 2 (cons (vector 3 "x") '())) '())))
+(equal? '(1 2) '(1 3))
+(equal? 'a 'a)
+(eq? 'a 'a)
+(eq? key (cons 1 2))
+
+;; many keys, and counting duplicates in linear time
+(define fill
+  (lambda (table i n)
+    (if (= i n)
+        table
+        (begin (hash-table-set! table i (* i i)) (fill table (+ i 1) n)))))
+(define big (fill (make-hash-table) 0 5000))
+(hash-table-count big)
+(hash-table-ref big 4999)
+(define remove-evens
+  (lambda (i)
+    (if (< i 5000)
+        (begin (hash-table-delete! big i) (remove-evens (+ i 2)))
+        #t)))
+(remove-evens 0)
+(hash-table-count big)
+(hash-table-ref/default big 10 'gone)
+(hash-table-ref big 11)
+
+(define seen (make-hash-table))
+(define count-distinct
+  (lambda (lst)
+    (if (null? lst)
+        (hash-table-count seen)
+        (begin (hash-table-set! seen (car lst) #t) (count-distinct (cdr lst))))))
+(count-distinct '(a b a "c" "c" (1) (1) 2 2.0 b))
+
+(define sum 0)
+(hash-table-walk (fill (make-hash-table) 0 10) (lambda (k v) (set! sum (+ sum v))))
+sum
+(hash-table-keys (fill (make-hash-table) 0 1))
+(hash-table->alist (fill (make-hash-table) 3 4))
+(hash-table-ref t 'apple)
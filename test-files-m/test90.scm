@@ -0,0 +1,40 @@
+;; strings
+(define s "hello, world")
+s
+(display s)
+(newline)
+(string? s)
+(string? 'hello)
+(string-length s)
+(string-length "")
+(substring s 7 12)
+(substring s 7)
+(substring (substring s 0 5) 1 3)
+(string-length (substring s 3 3))
+(string-append "foo" "bar" "" "baz")
+(string-append)
+(string-append (substring s 0 5) "!")
+(string=? "abc" "abc")
+(string=? "abc" (substring "xabc" 1 4))
+(string=? "abc" "abd")
+(string=? "a" "a" "a")
+(string<? "abc" "abd")
+(string<? "ab" "abc")
+(string<? "abc" "ab")
+(string<? "a" "b" "c")
+(string<? "a" "c" "b")
+(string->symbol "apple")
+(eq? (string->symbol (substring "an apple" 3)) 'apple)
+(symbol->string 'banana)
+(string-length (symbol->string 'banana))
+(equal? "pear" (substring "a pear tree" 2 6))
+(with-output-to-string (lambda () (display 42) (display " and ") (write "quoted")))
+(string-length (with-output-to-string (lambda () (display "abc"))))
+
+;; building a long string by appending slices
+(define repeat
+  (lambda (text n acc)
+    (if (= n 0) acc (repeat text (- n 1) (string-append acc (substring text 0 3))))))
+(string-length (repeat "abcdef" 1000 ""))
+(substring (repeat "abcdef" 4 "") 2 8)
+(substring s 5 20)
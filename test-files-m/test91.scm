@@ -0,0 +1,18 @@
+;; global references keep their binding once found, and see set! through it
+(define get-g (lambda () g))
+(define g 1)
+(get-g)
+(set! g 2)
+(get-g)
+(define bump (lambda () (set! g (+ g 10))))
+(bump)
+(bump)
+g
+(get-g)
+(define count 0)
+(define loop (lambda (n) (if (= n 0) count (begin (set! count (+ count 1)) (loop (- n 1))))))
+(loop 1000)
+(set! + -)
+(+ 5 3)
+(define get-h (lambda () h))
+(get-h)
@@ -0,0 +1,68 @@
+;; closures copy the variables they capture, and share the ones that change
+(define make-counter
+  (lambda ()
+    (let ((n 0))
+      (lambda () (set! n (+ n 1)) n))))
+(define c1 (make-counter))
+(define c2 (make-counter))
+(c1)
+(c1)
+(c2)
+(c1)
+(define make-account
+  (lambda (balance)
+    (cons (lambda (amount) (set! balance (+ balance amount)) balance)
+          (lambda () balance))))
+(define account (make-account 100))
+((car account) 50)
+((cdr account))
+(define late
+  (lambda (x)
+    (let ((get (lambda () x)))
+      (set! x (* x 2))
+      (get))))
+(late 21)
+(define adders
+  (lambda (n)
+    (if (= n 0)
+        '()
+        (cons (lambda (x) (+ x n)) (adders (- n 1))))))
+((car (adders 5)) 100)
+((car (cdr (adders 5))) 100)
+(define parity
+  (lambda (n)
+    (letrec ((even? (lambda (n) (if (= n 0) #t (odd? (- n 1)))))
+             (odd? (lambda (n) (if (= n 0) #f (even? (- n 1))))))
+      (even? n))))
+(parity 10)
+(parity 7)
+(define early
+  (lambda ()
+    (define get (lambda () later))
+    (define later 'defined-after)
+    (get)))
+(early)
+(define nested
+  (lambda (a)
+    (lambda (b)
+      (lambda (c)
+        (list3 a b c)))))
+(define list3 (lambda (a b c) (cons a (cons b (cons c '())))))
+(((nested 1) 2) 3)
+(define shadow
+  (lambda (x)
+    (let ((f (lambda (x) (set! x (+ x 1)) x)))
+      (cons (f 10) x))))
+(shadow 5)
+(define sum-to
+  (lambda (n)
+    (define loop (lambda (i total) (if (> i n) total (loop (+ i 1) (+ total i)))))
+    (loop 1 0)))
+(sum-to 100)
+(define too-soon
+  (lambda ()
+    (define get (lambda () later))
+    (get)
+    (define later 1)
+    later))
+(too-soon)
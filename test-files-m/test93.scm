@@ -0,0 +1,41 @@
+;; calls of primitives on constants are worked out once, before the program runs
+(+ 1 2 (* 3 4))
+(car (cdr '(1 2 3)))
+(if (< 1 2) 'yes 'no)
+(if #f (car '()) 'pruned)
+(define area
+  (lambda (r)
+    (let ((pi 3) (scale (* 2 5)))
+      (* pi scale r r))))
+(area 2)
+(define count
+  (let ((step 1))
+    (lambda (n) (if (= n 0) 0 (+ step (count (- n step)))))))
+(count 5)
+(define changed
+  (let ((x 1))
+    (lambda () (set! x (+ x 1)) x)))
+(changed)
+(changed)
+(define shadowed
+  (lambda (+)
+    (+ 1 2)))
+(shadowed *)
+;; calls that would be errors are left for when they run
+(define never
+  (lambda ()
+    (car '())))
+(define sum
+  (lambda ()
+    (+ 1 2)))
+(define doubled
+  (let ((three (+ 1 2)))
+    (lambda () (* three 2))))
+(sum)
+(doubled)
+;; a folded call goes back to calling once its primitive is changed
+(set! + -)
+(sum)
+(doubled)
+(+ 10 1)
+(quotient 7 0)
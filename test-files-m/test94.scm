@@ -0,0 +1,29 @@
+;; primitive calls with their arguments in an array rather than a list
+(define add3 (lambda (a b c) (+ a b c)))
+(add3 1 2 3)
+(+ 1 2 3 4 5 6 7 8 9 10 11 12)
+(< 1 2 3 4 5 6 7 8 9 10)
+(< 1 2 3 5 4)
+(- 10)
+(- 10 1 2)
+(* 4611686018427387903 2)
+(+ 4611686018427387903 4611686018427387903 -4611686018427387903)
+(/ 8 2 2)
+(quotient 17 5)
+(remainder -17 5)
+(modulo -17 5)
+(>= 3 3 2)
+(zero? 0.0)
+(define loop
+  (lambda (i acc)
+    (if (= i 0)
+        acc
+        (loop (- i 1) (cons (car (cons i '())) acc)))))
+(loop 5 '())
+(null? (cdr '(1)))
+(eq? 'a 'a)
+(equal? (cons 1 (cons "two" (vector 3.0))) (cons 1 (cons "two" (vector 3.0))))
+(equal? '(1 2) '(1 3))
+(define same? (lambda (a b) (equal? a b)))
+(same? "abc" "abc")
+(equal? 1)
@@ -0,0 +1,4 @@
+;; cdr of something that isn't a pair, through the array entry point
+(define second (lambda (x) (cdr x)))
+(second '(1 2))
+(cdr 5)
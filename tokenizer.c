@@ -1,210 +1,274 @@
 #include "schemeitem.h"
 #include "linkedlist.h"
 #include "talloc.h"
+#include "gc.h"
+#include "symbols.h"
+#include "port.h"
+#include "number.h"
+#include "schemestring.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
-#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// How much of the input is read at once, when it can't be mapped
+#define INPUT_CHUNK_SIZE (64 * 1024)
+
+// What kind of token the reader is in the middle of
+typedef enum {
+    DEFAULT_STATE, // between tokens
+    COMMENT_STATE,
+    STRING_STATE,
+    NUMBER_STATE,
+    SIGN_STATE,    // just read a + or -, which starts either a number or a symbol
+    BOOL_STATE,    // just read a #, which starts a boolean or a vector
+    SYMBOL_STATE
+} readerState;
+
+// The input buffer. A regular file is mapped in whole, so input holds all of it.
+// Anything else (a pipe, a terminal) is read a chunk at a time with read, and the
+// buffer only holds the token being read plus whatever follows it.
+int input_fd = -1;
+char *input = NULL;
+size_t input_length = 0;   // how many bytes of input are valid
+size_t input_position = 0; // the next byte to look at
+size_t input_capacity = 0;
+bool input_mapped = false;
+bool input_finished = false;
+
+// Parentheses and quotes carry nothing but their type, so there is one of each
+SchemeItem *open_token = NULL;
+SchemeItem *close_token = NULL;
+SchemeItem *quote_token = NULL;
+SchemeItem *open_vector_token = NULL;
+
+// Makes a permanent token of the given type
+SchemeItem *makeToken(itemType type) {
+    SchemeItem *token = gcAllocPermanent(GC_ITEM, sizeof(SchemeItem));
+    token->type = type;
+    return token;
+}
 
+// Starts reading from the file at path, or from stdin if path is NULL. Regular
+// files are mapped in instead of being read.
+void openInput(char *path) {
+    open_token = makeToken(OPEN_TYPE);
+    close_token = makeToken(CLOSE_TYPE);
+    quote_token = makeToken(SINGLEQUOTE_TYPE);
+    open_vector_token = makeToken(OPENVECTOR_TYPE);
+
+    input_fd = STDIN_FILENO;
+    if (path != NULL) {
+        input_fd = open(path, O_RDONLY);
+        if (input_fd < 0) {
+            fprintf(stderr, "Could not open %s\n", path);
+            texit(1);
+        }
+    }
 
-// Reads an input file through the command like using fgetc.
-// Tokenizes the given scheme file by catagorizing each token into a type based on the first character read
-// Creates a linked list of all the tokens in the file.
-//
-// Important variables:
-// - current_token -> character array of the current token we are creating/reading
-// - index -> helper int index for the index of the current_token string
-// - state -> tells us what kind of token we are creating, and how we should proceed (DEFAULT if we are unsure)
-SchemeItem *tokenize() {
-    char state[16] = "DEFAULT"; // boolean, number (integer or double), string, symbol, quote, comment, open, close, 
-    char current_token[300];
-    int index = 0;
-
-    int charRead;
-    SchemeItem *list = makeEmpty();
-    
-    charRead = fgetc(stdin);
-
-    while (charRead != EOF) {
-        //printf("%c\n", charRead);
-
-        if (strcmp(state, "COMMENT") == 0) { // if we are in a comment
-            if (charRead == '\n') {
-                strcpy(state, "DEFAULT"); // end of comment
-            }
+    struct stat info;
+    if (fstat(input_fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0
+        && lseek(input_fd, 0, SEEK_CUR) == 0) {
+        void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+            input = mapped;
+            input_length = info.st_size;
+            input_mapped = true;
+            input_finished = true;
+            return;
         }
+    }
 
-        else if (strcmp(state, "STRING") == 0) {
-            current_token[index++] = charRead;
-            if (charRead == '"') {  // closing quotations, string is over
-                current_token[index] = '\0';
+    input_capacity = INPUT_CHUNK_SIZE;
+    input = malloc(input_capacity);
+}
 
-                // Add it to the linked list
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = STR_TYPE;
-                new_node->s = talloc(strlen(current_token) + 1);
-                strcpy(new_node->s, current_token);
+// Reads more input into the buffer. Everything from *token_start on is kept, and
+// moved to the front of the buffer (with *token_start and input_position moved
+// along with it), growing the buffer if the token fills all of it.
+//
+// Returns false at the end of the input
+bool readMoreInput(size_t *token_start) {
+    if (input_finished) {
+        return false;
+    }
 
-                list = cons(new_node, list);
+    size_t keep = input_length - *token_start;
+    memmove(input, input + *token_start, keep);
+    input_position = input_position - *token_start;
+    input_length = keep;
+    *token_start = 0;
+    if (input_length == input_capacity) {
+        input_capacity = input_capacity * 2;
+        input = realloc(input, input_capacity);
+    }
 
-                index = 0;
-                strcpy(state, "DEFAULT");
-            }
-        } 
+    ssize_t count = read(input_fd, input + input_length, input_capacity - input_length);
+    if (count <= 0) {
+        input_finished = true;
+        return false;
+    }
+    input_length = input_length + count;
+    return true;
+}
 
-        else if (strcmp(state, "NUMBER") == 0) {
-            if ((charRead >= '0' && charRead <= '9') || charRead == '.') {
-                current_token[index++] = charRead;
-                // here we should probably make sure that we can't add more than one '.'
-            } else {
-                current_token[index] = '\0';
-
-                char *endptr;
-                int num = atoi(current_token);
-                double num_d = strtod(current_token, &endptr);
-                if (strchr(current_token, '.') != NULL) {
-                    SchemeItem *new_node = makeEmpty();
-                    new_node->type = DOUBLE_TYPE;
-                    new_node->d = num_d;
-
-                    list = cons(new_node, list);
-                } else {
-                    SchemeItem *new_node = makeEmpty();
-                    new_node->type = INT_TYPE;
-                    new_node->i = num;
+// The characters that end a symbol
+const bool delimiters[256] = {
+    ['('] = true, [')'] = true, ['"'] = true, [';'] = true,
+    [' '] = true, ['\t'] = true, ['\n'] = true, ['\v'] = true, ['\f'] = true, ['\r'] = true
+};
+
+// Makes the token for the number input[start, end)
+SchemeItem *makeNumber(size_t start, size_t end) {
+    char *text = input + start;
+    size_t length = end - start;
+    if (memchr(text, '.', length) == NULL) {
+        return parseInteger(text, length);
+    }
 
-                    list = cons(new_node, list);
-                }
+    // strtod needs the text null terminated
+    char buffer[64];
+    char *copy = length < sizeof(buffer) ? buffer : talloc(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
 
-                index = 0;
-                strcpy(state, "DEFAULT");
-                ungetc(charRead, stdin);
-            }
-        }
+    SchemeItem *new_node = makeItem(DOUBLE_TYPE);
+    new_node->d = strtod(copy, NULL);
+    return new_node;
+}
 
-        else if (strcmp(state, "BOOL") == 0) {
-            if (charRead == 't' || charRead == 'f') {
-                current_token[index++] = charRead;
-                current_token[index] = '\0';   
-
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = BOOL_TYPE;
-                new_node->s = talloc(strlen(current_token)+1);
-                strcpy(new_node->s, current_token);    
-                
-                list = cons(new_node, list);
-
-                index = 0;
-                
-                strcpy(state, "DEFAULT");
-            } else {
-                printf("Syntax error (readBoolean): boolean was not #t or #f\n");
-                texit(1);
-            }
-        }
+// Reads the next token from the input (see openInput, which is called on stdin if
+// it hasn't been already), and returns it, or NULL once the input runs out. The
+// kind of token is decided by the first character read.
+//
+// Token text is sliced straight out of the input buffer, so tokens can be of any
+// length. start is where the current token starts.
+SchemeItem *readToken() {
+    if (input == NULL) {
+        openInput(NULL);
+    }
+
+    readerState state = DEFAULT_STATE;
+    size_t start = input_position;
 
-        else if (strcmp(state, "SYMBOL") == 0) {
-            if (charRead == '(' || charRead == ')' || charRead == '"' || isspace(charRead) || charRead == ';') {
-                current_token[index] = '\0';
+    while (input_position < input_length || readMoreInput(&start)) {
+        char charRead = input[input_position];
 
-                // Add it to the linked list
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = SYMBOL_TYPE;
-                new_node->s = talloc(strlen(current_token) + 1);
-                strcpy(new_node->s, current_token);
+        switch (state) {
+            case COMMENT_STATE: { // skip to the end of the line
+                char *newline = memchr(input + input_position, '\n', input_length - input_position);
+                if (newline == NULL) {
+                    input_position = input_length;
+                    start = input_position; // none of the comment needs to be kept
+                } else {
+                    input_position = newline - input + 1;
+                    state = DEFAULT_STATE;
+                }
+                break;
+            }
 
-                list = cons(new_node, list);
+            case STRING_STATE: { // the string is the text between the quotes
+                char *quote = memchr(input + input_position, '"', input_length - input_position);
+                if (quote == NULL) {
+                    input_position = input_length;
+                    break;
+                }
+                input_position = quote - input + 1;
+                return makeString(input + start + 1, input_position - start - 2);
+            }
 
-                index = 0;
-                strcpy(state, "DEFAULT");
-                ungetc(charRead, stdin); // adds same symbol back, so you pull the same thing again.
-            } else {
-                current_token[index++] = charRead;
+            case NUMBER_STATE: {
+                // here we should probably make sure that we can't add more than one '.'
+                size_t end = input_position;
+                while (end < input_length && ((input[end] >= '0' && input[end] <= '9') || input[end] == '.')) {
+                    end++;
+                }
+                input_position = end;
+                if (end < input_length) {
+                    return makeNumber(start, end);
+                }
+                break;
             }
-        } 
-        
-        else if (strcmp(state, "DEFAULT") == 0) {
-            if (charRead == ';') {
-                strcpy(state, "COMMENT");
-            } else if (charRead == '"') {
-                index = 0;
-                current_token[index++] = charRead;
-                strcpy(state, "STRING");
-            } else if (charRead >= '0' && charRead <= '9') {
-                index = 0;
-                current_token[index++] = charRead;
-                strcpy(state, "NUMBER");
-            } else if (charRead == '(') {
-                current_token[index++] = charRead;
-
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = OPEN_TYPE;
-                list = cons(new_node, list);
-
-                index = 0;
-                strcpy(state, "DEFAULT");
-            } else if (charRead == ')') {
-                current_token[index++] = charRead;
-
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = CLOSE_TYPE;
-                list = cons(new_node, list);
-
-                index = 0;
-                strcpy(state, "DEFAULT");
-            } else if (charRead == '\'') {
-                current_token[index++] = charRead;
-
-                SchemeItem *new_node = makeEmpty();
-                new_node->type = SINGLEQUOTE_TYPE;
-                list = cons(new_node, list);
-
-                index = 0;
-                strcpy(state, "DEFAULT");
-            } else if (charRead == '#') {
-                index = 0;
-                current_token[index++] = charRead;
-                strcpy(state, "BOOL");
-            } else if (charRead == '-' || charRead == '+') {
-                int previous = charRead;
-
-                charRead = fgetc(stdin);
-
-                if (charRead >= '0' && charRead <= '9') {
-                    ungetc(charRead, stdin);
-                    charRead = previous;
-                    
-                    index = 0;
-                    current_token[index++] = charRead;
-                    strcpy(state, "NUMBER");
-                } else {
-                    ungetc(charRead, stdin);
-                    charRead = previous;
 
-                    index = 0;
-                    current_token[index++] = charRead;
+            case SIGN_STATE:
+                state = (charRead >= '0' && charRead <= '9') ? NUMBER_STATE : SYMBOL_STATE;
+                break;
 
-                    strcpy(state, "SYMBOL");
+            case BOOL_STATE:
+                if (charRead == 't' || charRead == 'f') {
+                    input_position++;
+                    return makeBool(charRead == 't');
                 }
-            } else if (charRead == '@') {
-                printf("Syntax error (readSymbol): symbol @ does not start with an allowed first character.\n");
-            } else if (charRead == '{') {
-                printf("Syntax error (readSymbol): symbol { does not start with an allowed first character.\n");
-            } else if (isspace(charRead)) {
-                // do nothing
-            } else {
-                // we have a symbol
-                index = 0;
-
-                current_token[index++] = charRead;
-                strcpy(state, "SYMBOL");
+                if (charRead == '(') {
+                    input_position++;
+                    return open_vector_token;
+                }
+                printf("Syntax error (readBoolean): boolean was not #t or #f\n");
+                texit(1);
+                break;
+
+            case SYMBOL_STATE: {
+                size_t end = input_position;
+                while (end < input_length && !delimiters[(unsigned char)input[end]]) {
+                    end++;
+                }
+                input_position = end;
+                if (end < input_length) {
+                    // Every occurrence of a name shares one symbol
+                    return internLength(input + start, end - start);
+                }
+                break;
             }
-        }
 
-        charRead = fgetc(stdin);
+            case DEFAULT_STATE:
+                start = input_position;
+                input_position++;
+                if (charRead == ';') {
+                    state = COMMENT_STATE;
+                } else if (charRead == '"') {
+                    state = STRING_STATE;
+                } else if (charRead >= '0' && charRead <= '9') {
+                    state = NUMBER_STATE;
+                } else if (charRead == '(') {
+                    return open_token;
+                } else if (charRead == ')') {
+                    return close_token;
+                } else if (charRead == '\'') {
+                    return quote_token;
+                } else if (charRead == '#') {
+                    state = BOOL_STATE;
+                } else if (charRead == '-' || charRead == '+') {
+                    state = SIGN_STATE;
+                } else if (charRead == '@') {
+                    portWriteString(currentOutput(), "Syntax error (readSymbol): symbol @ does not start with an allowed first character.\n");
+                } else if (charRead == '{') {
+                    portWriteString(currentOutput(), "Syntax error (readSymbol): symbol { does not start with an allowed first character.\n");
+                } else if (delimiters[(unsigned char)charRead]) {
+                    // whitespace, do nothing
+                } else {
+                    // we have a symbol
+                    state = SYMBOL_STATE;
+                }
+                break;
+        }
     }
 
-    SchemeItem *revList = reverse(list);
-    return revList;
+    // A number or symbol can run right up to the end of the input
+    if (state == NUMBER_STATE) {
+        return makeNumber(start, input_position);
+    } else if (state == SIGN_STATE || state == SYMBOL_STATE) {
+        return internLength(input + start, input_position - start);
+    } else if (state == STRING_STATE) {
+        printf("Syntax error (readString): string was never closed\n");
+        texit(1);
+    }
+    return NULL;
 }
 
 // Recieves a linked list as input 
@@ -214,24 +278,30 @@ SchemeItem *tokenize() {
 void displayTokens(SchemeItem *list) {
     SchemeItem *current = list;
 
-    while (current->type == CONS_TYPE) {
+    while (typeOf(current) == CONS_TYPE) {
         SchemeItem *my_car = current->car;
 
-        if (my_car->type == OPEN_TYPE) {
+        if (typeOf(my_car) == OPEN_TYPE) {
             printf("(:open\n");
-        } else if (my_car->type == CLOSE_TYPE) {
+        } else if (typeOf(my_car) == OPENVECTOR_TYPE) {
+            printf("#(:openvector\n");
+        } else if (typeOf(my_car) == CLOSE_TYPE) {
             printf("):close\n");
-        } else if (my_car->type == STR_TYPE) {
-            printf("%s:string\n", my_car->s);
-        } else if (my_car->type == INT_TYPE) {
-            printf("%d:integer\n", my_car->i);
-        } else if (my_car->type == SYMBOL_TYPE) {
+        } else if (typeOf(my_car) == STR_TYPE) {
+            printf("\"%.*s\":string\n", (int)my_car->length, stringChars(my_car));
+        } else if (typeOf(my_car) == INT_TYPE) {
+            printf("%ld:integer\n", fixnumValue(my_car));
+        } else if (typeOf(my_car) == BIGNUM_TYPE) {
+            char *digits = bignumToString(my_car);
+            printf("%s:integer\n", digits);
+            free(digits);
+        } else if (typeOf(my_car) == SYMBOL_TYPE) {
             printf("%s:symbol\n", my_car->s);
-        } else if (my_car->type == BOOL_TYPE) {
-            printf("%s:boolean\n", my_car->s);
-        } else if (my_car->type == DOUBLE_TYPE){
+        } else if (typeOf(my_car) == BOOL_TYPE) {
+            printf("%s:boolean\n", my_car == SCHEME_TRUE ? "#t" : "#f");
+        } else if (typeOf(my_car) == DOUBLE_TYPE){
             printf("%f:double\n", my_car->d);
-        } else if (my_car->type == SINGLEQUOTE_TYPE){
+        } else if (typeOf(my_car) == SINGLEQUOTE_TYPE){
             printf("':quote\n");
         }
         current = current->cdr;
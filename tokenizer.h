@@ -3,9 +3,13 @@
 #ifndef _TOKENIZER
 #define _TOKENIZER
 
-// Read all of the input from stdin, and return a linked list consisting of the
-// tokens.
-SchemeItem *tokenize();
+// Starts reading from the file at path, or from stdin if path is NULL. A regular
+// file is mapped into memory, anything else is read through a buffer.
+void openInput(char *path);
+
+// Reads the next token from the input, or returns NULL at the end of it. The
+// input is stdin unless openInput was called first.
+SchemeItem *readToken();
 
 // Displays the contents of the linked list as tokens, with type information
 void displayTokens(SchemeItem *list);
@@ -0,0 +1,545 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "schemeitem.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "gc.h"
+#include "interpreter.h"
+#include "vm.h"
+#include "stats.h"
+#include "profile.h"
+
+// How many values (and saved returns) the VM can hold at once
+#define VM_STACK_SIZE (1024 * 1024)
+
+// Where to go back to once a call returns
+typedef struct ControlRecord {
+    Code *code;
+    int *pc;
+    size_t base; // the stack height the caller's values start at
+} ControlRecord;
+
+// The value stack. It holds the arguments and temporaries of every active call,
+// plus the frame each call has to go back to, and is a root of the collector.
+SchemeItem **vm_stack = NULL;
+size_t vm_sp = 0;
+
+ControlRecord *vm_control = NULL;
+size_t vm_control_count = 0;
+
+// The code of every call still running, innermost last: the code each active
+// vmRun is in now, and under it the callers' code saved in vm_control. Also a
+// root, so that code isn't freed while it runs after its closure has gone.
+Code **vm_codes = NULL;
+size_t vm_code_count = 0;
+
+// The code vmApply runs for each number of arguments (see vmTrampoline)
+Code **trampolines = NULL;
+size_t trampoline_capacity = 0;
+
+// Sets up the stacks the first time the VM runs
+void vmInit() {
+    vm_stack = talloc(VM_STACK_SIZE * sizeof(SchemeItem *));
+    vm_control = talloc(VM_STACK_SIZE * sizeof(ControlRecord));
+    vm_codes = talloc(2 * VM_STACK_SIZE * sizeof(Code *));
+    gcAddRootArray((void **)vm_stack, &vm_sp);
+    gcAddRootArray((void **)vm_codes, &vm_code_count);
+}
+
+// Makes sure there is room on the stacks to start running code
+void vmCheckStack(Code *code) {
+    if (vm_sp + code->maxStack + 1 > VM_STACK_SIZE || vm_control_count == VM_STACK_SIZE
+        || vm_code_count + 1 >= 2 * VM_STACK_SIZE) {
+        printf("Evaluation error: stack overflow\n");
+        texit(1);
+    }
+}
+
+// Reports a variable that hasn't been bound yet
+void vmUnbound(SchemeItem *name) {
+    printf("Evaluation error: symbol '%s' wasn't found\n", name->s);
+    texit(1);
+}
+
+// Looks up the global named by the name operand at pc, and caches its cell in the
+// constant named by the cache operand after it (see Code). Returns NULL if the
+// global isn't defined yet, leaving the cache empty.
+SchemeItem *vmGlobalBinding(SchemeItem **constants, int *pc) {
+    SchemeItem *pair = findGlobalBinding(constants[pc[0]]);
+    constants[pc[1]] = pair;
+    return pair;
+}
+
+// Makes the frame for a call to the closure under the top count values on the
+// stack, with the arguments in its first slots (and any extra ones in a list in
+// the rest slot). The arguments stay on the stack.
+Frame *vmCallFrame(int count) {
+    SchemeItem *function = vm_stack[vm_sp - count - 1];
+    Code *code = function->lambda->ptr;
+    if (count < code->paramCount || (!code->rest && count != code->paramCount)) {
+        printf("Evaluation error: wrong number of arguments\n");
+        texit(1);
+    }
+
+    SchemeItem *rest = NULL;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(rest);
+    if (code->rest) {
+        rest = makeEmpty();
+        for (int i = count - 1; i >= code->paramCount; i--) {
+            rest = cons(vm_stack[vm_sp - count + i], rest);
+        }
+    }
+
+    STAT(statsApply(true));
+    function = vm_stack[vm_sp - count - 1];
+    Frame *frame = makeFrame(function->frame, code->frameSize);
+    for (int i = 0; i < code->paramCount; i++) {
+        frame->slots[i] = vm_stack[vm_sp - count + i];
+    }
+    if (code->rest) {
+        frame->slots[code->paramCount] = rest;
+    }
+
+    gcRestoreRoots(roots);
+    return frame;
+}
+
+// Calls the primitive under the top count values on the stack, with those values
+// as its arguments. The arguments stay on the stack. A primitive with an array
+// entry point gets them right where they are; the rest get a list.
+SchemeItem *vmCallPrimitive(int count) {
+    SchemeItem *function = vm_stack[vm_sp - count - 1];
+    if (typeOf(function) == PRIMITIVE_TYPE && function->fixed != NULL) {
+        STAT(statsApply(false));
+        return function->fixed(vm_stack + vm_sp - count, count);
+    }
+
+    SchemeItem *args = makeEmpty();
+    size_t roots = gcSaveRoots();
+    GC_ROOT(args);
+    for (int i = count - 1; i >= 0; i--) {
+        args = cons(vm_stack[vm_sp - count + i], args);
+    }
+    gcRestoreRoots(roots);
+
+    function = vm_stack[vm_sp - count - 1];
+    if (typeOf(function) != PRIMITIVE_TYPE) {
+        printf("Evaluation error: not a procedure\n");
+        texit(1);
+    }
+    STAT(statsApply(false));
+    return function->pf(args);
+}
+
+#define NEXT goto *dispatch[*pc++]
+#define PUSH(value) (vm_stack[vm_sp++] = (value))
+#define TOP (vm_stack[vm_sp - 1])
+
+// Runs code until it returns (see vm.h). Dispatch is threaded: every instruction
+// jumps straight to the next one's handler through the dispatch table, instead
+// of going back around a loop and through a switch.
+SchemeItem *vmRun(Code *code) {
+    static void *dispatch[OP_COUNT] = {
+        [OP_CONST] = &&op_const,
+        [OP_FOLDED] = &&op_folded,
+        [OP_LOCAL0] = &&op_local0,
+        [OP_LOCAL] = &&op_local,
+        [OP_BOXED] = &&op_boxed,
+        [OP_GLOBAL] = &&op_global,
+        [OP_SET_LOCAL] = &&op_set_local,
+        [OP_SET_BOXED] = &&op_set_boxed,
+        [OP_SET_GLOBAL] = &&op_set_global,
+        [OP_BOX] = &&op_box,
+        [OP_DEFINE_LOCAL] = &&op_define_local,
+        [OP_DEFINE_GLOBAL] = &&op_define_global,
+        [OP_POP] = &&op_pop,
+        [OP_JUMP] = &&op_jump,
+        [OP_JUMP_IF_FALSE] = &&op_jump_if_false,
+        [OP_JUMP_IF_FALSE_KEEP] = &&op_jump_if_false_keep,
+        [OP_JUMP_IF_TRUE_KEEP] = &&op_jump_if_true_keep,
+        [OP_CLOSURE] = &&op_closure,
+        [OP_ENTER] = &&op_enter,
+        [OP_ENTER_REC] = &&op_enter_rec,
+        [OP_STORE_REC] = &&op_store_rec,
+        [OP_LEAVE] = &&op_leave,
+        [OP_CALL] = &&op_call,
+        [OP_TAIL_CALL] = &&op_tail_call,
+        [OP_RETURN] = &&op_return,
+    };
+
+    if (vm_stack == NULL) {
+        vmInit();
+    }
+
+    Frame *frame = NULL;
+    size_t roots = gcSaveRoots();
+    GC_ROOT(frame);
+
+    size_t entry_control = vm_control_count;
+    size_t base = vm_sp;
+    bool entered = false; // whether a tail call from the code we started with is on the profiler's stack
+    vmCheckStack(code);
+    vm_codes[vm_code_count++] = code;
+    int *pc = code->instructions;
+    SchemeItem **constants = code->constants;
+
+    NEXT;
+
+op_const:
+    PUSH(constants[pc[0]]);
+    pc = pc + 1;
+    NEXT;
+
+op_folded:
+    if (pc[1] == (int)primitiveRedefinitions()) {
+        PUSH(constants[pc[0]]);
+        pc = code->instructions + pc[2];
+        NEXT;
+    }
+    pc = pc + 3;
+    NEXT;
+
+op_local0: {
+    STAT(statsLocalLookup(0));
+    SchemeItem *value = frame->slots[pc[0]];
+    if (value == NULL) {
+        vmUnbound(constants[pc[1]]);
+    }
+    PUSH(value);
+    pc = pc + 2;
+    NEXT;
+}
+
+op_local: {
+    STAT(statsLocalLookup(pc[0]));
+    SchemeItem *value = frameAt(frame, pc[0])->slots[pc[1]];
+    if (value == NULL) {
+        vmUnbound(constants[pc[2]]);
+    }
+    PUSH(value);
+    pc = pc + 3;
+    NEXT;
+}
+
+op_boxed: {
+    STAT(statsLocalLookup(pc[0]));
+    SchemeItem *value = frameAt(frame, pc[0])->slots[pc[1]]->contents;
+    if (value == NULL) {
+        vmUnbound(constants[pc[2]]);
+    }
+    PUSH(value);
+    pc = pc + 3;
+    NEXT;
+}
+
+op_global: {
+    SchemeItem *pair = constants[pc[1]];
+    if (pair == NULL) {
+        pair = vmGlobalBinding(constants, pc);
+        if (pair == NULL) {
+            vmUnbound(constants[pc[0]]);
+        }
+    }
+    PUSH(pair->cdr);
+    pc = pc + 2;
+    NEXT;
+}
+
+op_set_local: {
+    Frame *target = frameAt(frame, pc[0]);
+    if (target->slots[pc[1]] == NULL) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    target->slots[pc[1]] = TOP;
+    gcWriteBarrier(target);
+    TOP = SCHEME_VOID;
+    pc = pc + 3;
+    NEXT;
+}
+
+op_set_boxed: {
+    SchemeItem *box = frameAt(frame, pc[0])->slots[pc[1]];
+    if (box->contents == NULL) {
+        printf("Evaluation error\n");
+        texit(1);
+    }
+    box->contents = TOP;
+    gcWriteBarrier(box);
+    TOP = SCHEME_VOID;
+    pc = pc + 3;
+    NEXT;
+}
+
+op_set_global: {
+    SchemeItem *pair = constants[pc[1]];
+    if (pair == NULL) {
+        pair = vmGlobalBinding(constants, pc);
+        if (pair == NULL) {
+            printf("Evaluation error\n");
+            texit(1);
+        }
+    }
+    setGlobal(pair, TOP);
+    TOP = SCHEME_VOID;
+    pc = pc + 2;
+    NEXT;
+}
+
+op_box:
+    boxSlot(frame, pc[0]);
+    pc = pc + 1;
+    NEXT;
+
+op_define_local:
+    defineSlot(frame, pc[0], TOP);
+    TOP = SCHEME_VOID;
+    pc = pc + 1;
+    NEXT;
+
+op_define_global:
+    if (findGlobalBinding(constants[pc[0]]) != NULL) {
+        printf("Evaluation error: duplicate binding for '%s'\n", constants[pc[0]]->s);
+        texit(1);
+    }
+    addBinding(constants[pc[0]], TOP);
+    TOP = SCHEME_VOID;
+    pc = pc + 1;
+    NEXT;
+
+op_pop:
+    vm_sp--;
+    NEXT;
+
+op_jump:
+    pc = code->instructions + pc[0];
+    NEXT;
+
+op_jump_if_false:
+    vm_sp--;
+    if (isFalse(vm_stack[vm_sp])) {
+        pc = code->instructions + pc[0];
+    } else {
+        pc = pc + 1;
+    }
+    NEXT;
+
+op_jump_if_false_keep:
+    if (isFalse(TOP)) {
+        pc = code->instructions + pc[0];
+    } else {
+        vm_sp--;
+        pc = pc + 1;
+    }
+    NEXT;
+
+op_jump_if_true_keep:
+    if (!isFalse(TOP)) {
+        pc = code->instructions + pc[0];
+    } else {
+        vm_sp--;
+        pc = pc + 1;
+    }
+    NEXT;
+
+op_closure: {
+    int count = pc[1];
+    Frame *captured = NULL;
+    if (count > 0) {
+        captured = makeFrame(NULL, count);
+        for (int i = 0; i < count; i++) {
+            captured->slots[i] = vm_stack[vm_sp - count + i];
+        }
+        vm_sp = vm_sp - count;
+    }
+    SchemeItem *closure = makeClosure(constants[pc[0]], captured);
+    closure->name = ((Code *)closure->lambda->ptr)->name;
+    PUSH(closure);
+    pc = pc + 2;
+    NEXT;
+}
+
+op_enter: {
+    int count = pc[1];
+    Frame *new_frame = makeFrame(frame, pc[0]);
+    for (int i = 0; i < count; i++) {
+        new_frame->slots[i] = vm_stack[vm_sp - count + i];
+    }
+    vm_sp = vm_sp - count;
+    PUSH((SchemeItem *)frame);
+    frame = new_frame;
+    pc = pc + 2;
+    NEXT;
+}
+
+op_enter_rec: {
+    Frame *new_frame = makeFrame(frame, pc[0]);
+    for (int i = 0; i < new_frame->size; i++) {
+        new_frame->slots[i] = SCHEME_UNSPECIFIED;
+    }
+    PUSH((SchemeItem *)frame);
+    frame = new_frame;
+    pc = pc + 1;
+    NEXT;
+}
+
+op_store_rec: {
+    vm_sp--;
+    SchemeItem *value = vm_stack[vm_sp];
+    if (typeOf(value) == SYMBOL_TYPE || value == SCHEME_UNSPECIFIED) {
+        printf("Evaluation Error\n");
+        texit(1);
+    }
+    defineSlot(frame, pc[0], value);
+    pc = pc + 1;
+    NEXT;
+}
+
+op_leave: {
+    SchemeItem *value = vm_stack[vm_sp - 1];
+    frame = (Frame *)vm_stack[vm_sp - 2];
+    vm_sp--;
+    TOP = value;
+    NEXT;
+}
+
+op_call: {
+    int count = pc[0];
+    pc = pc + 1;
+    if (typeOf(vm_stack[vm_sp - count - 1]) != CLOSURE_TYPE) {
+        SchemeItem *result = vmCallPrimitive(count);
+        vm_sp = vm_sp - count - 1;
+        PUSH(result);
+        NEXT;
+    }
+
+    Frame *new_frame = vmCallFrame(count);
+    SchemeItem *function = vm_stack[vm_sp - count - 1];
+    vm_sp = vm_sp - count - 1;
+    vmCheckStack(function->lambda->ptr);
+    vm_codes[vm_code_count++] = function->lambda->ptr;
+    profileEnter(function);
+
+    vm_control[vm_control_count].code = code;
+    vm_control[vm_control_count].pc = pc;
+    vm_control[vm_control_count].base = base;
+    vm_control_count++;
+    PUSH((SchemeItem *)frame);
+    base = vm_sp;
+
+    frame = new_frame;
+    code = function->lambda->ptr;
+    constants = code->constants;
+    pc = code->instructions;
+    NEXT;
+}
+
+op_tail_call: {
+    int count = pc[0];
+    if (typeOf(vm_stack[vm_sp - count - 1]) != CLOSURE_TYPE) {
+        SchemeItem *result = vmCallPrimitive(count);
+        vm_sp = vm_sp - count - 1;
+        PUSH(result);
+        goto op_return;
+    }
+
+    // the new frame replaces the current one, and the caller's return is left as it is
+    Frame *new_frame = vmCallFrame(count);
+    SchemeItem *function = vm_stack[vm_sp - count - 1];
+    vm_sp = base;
+    if (vm_control_count == entry_control && !entered) {
+        profileEnter(function);
+        entered = true;
+    } else {
+        profileReplace(function);
+    }
+
+    frame = new_frame;
+    code = function->lambda->ptr;
+    constants = code->constants;
+    pc = code->instructions;
+    vmCheckStack(code);
+    vm_codes[vm_code_count - 1] = code;
+    NEXT;
+}
+
+op_return: {
+    SchemeItem *value = TOP;
+    vm_sp = base;
+    vm_code_count--;
+    if (vm_control_count == entry_control) {
+        if (entered) {
+            profileLeave();
+        }
+        gcRestoreRoots(roots);
+        return value;
+    }
+
+    profileLeave();
+    vm_sp--;
+    frame = (Frame *)vm_stack[vm_sp];
+    vm_control_count--;
+    code = vm_control[vm_control_count].code;
+    pc = vm_control[vm_control_count].pc;
+    base = vm_control[vm_control_count].base;
+    constants = code->constants;
+    PUSH(value);
+    NEXT;
+}
+}
+
+// Returns the code {OP_CALL count, OP_RETURN} that vmApply runs. Each is made
+// the first time it is needed, in permanent memory, and kept.
+Code *vmTrampoline(int count) {
+    if ((size_t)count >= trampoline_capacity) {
+        size_t capacity = trampoline_capacity == 0 ? 16 : trampoline_capacity;
+        while (capacity <= (size_t)count) {
+            capacity = capacity * 2;
+        }
+        trampolines = realloc(trampolines, capacity * sizeof(Code *));
+        if (trampolines == NULL) {
+            printf("Error: out of memory\n");
+            exit(1);
+        }
+        for (size_t i = trampoline_capacity; i < capacity; i++) {
+            trampolines[i] = NULL;
+        }
+        trampoline_capacity = capacity;
+    }
+    if (trampolines[count] == NULL) {
+        Code *code = gcAllocPermanent(GC_CODE, sizeof(Code));
+        code->instructions = gcAllocPermanent(GC_RAW, 3 * sizeof(int));
+        code->instructions[0] = OP_CALL;
+        code->instructions[1] = count;
+        code->instructions[2] = OP_RETURN;
+        code->maxStack = 1;
+        trampolines[count] = code;
+    }
+    return trampolines[count];
+}
+
+// Calls function with the list args from C. The function and its arguments are
+// pushed, and then run by a bit of code that calls them and returns.
+SchemeItem *vmApply(SchemeItem *function, SchemeItem *args) {
+    if (vm_stack == NULL) {
+        vmInit();
+    }
+
+    int count = length(args);
+    if (vm_sp + count + 1 > VM_STACK_SIZE) {
+        printf("Evaluation error: stack overflow\n");
+        texit(1);
+    }
+    size_t saved_sp = vm_sp;
+    PUSH(function);
+    while (typeOf(args) == CONS_TYPE) {
+        PUSH(args->car);
+        args = args->cdr;
+    }
+
+    SchemeItem *result = vmRun(vmTrampoline(count));
+    vm_sp = saved_sp;
+    return result;
+}
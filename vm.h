@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include "schemeitem.h"
+
+#ifndef _VM
+#define _VM
+
+// The bytecode instruction set. Each instruction is an opcode followed by its
+// operands, all stored as ints. Stack effects are given as (before -- after).
+typedef enum {
+    OP_CONST,              // k: push constant k                      ( -- value)
+    OP_FOLDED,             // k redefinitions end: push constant k and jump to end, unless
+                           // a primitive has been redefined since (then run the call after it)
+    OP_LOCAL0,             // index name: slot of the current frame   ( -- value)
+    OP_LOCAL,              // depth index name: slot depth frames out ( -- value)
+    OP_BOXED,              // depth index name: value in the box in a slot ( -- value)
+    OP_GLOBAL,             // name cache: value of a global           ( -- value)
+    OP_SET_LOCAL,          // depth index name                        (value -- void)
+    OP_SET_BOXED,          // depth index name                        (value -- void)
+    OP_SET_GLOBAL,         // name cache                              (value -- void)
+    OP_BOX,                // index: puts a box around a slot of the current frame
+    OP_DEFINE_LOCAL,       // index: internal define (into the slot's box if it has one)
+                           //                                         (value -- void)
+    OP_DEFINE_GLOBAL,      // name                                    (value -- void)
+    OP_POP,                //                                         (value -- )
+    OP_JUMP,               // target
+    OP_JUMP_IF_FALSE,      // target                                  (value -- )
+    OP_JUMP_IF_FALSE_KEEP, // target: jumps keeping the value if it is #f, else pops it
+    OP_JUMP_IF_TRUE_KEEP,  // target: jumps keeping the value unless it is #f, else pops it
+    OP_CLOSURE,            // k count: closure for code constant k, capturing the top count values
+                           //                                         (values -- closure)
+    OP_ENTER,              // size count: new frame with the top count values in its first slots
+                           //                                         (values -- saved frame)
+    OP_ENTER_REC,          // size: new frame with every slot unassigned ( -- saved frame)
+    OP_STORE_REC,          // index: letrec init (into the slot's box if it has one) (value -- )
+    OP_LEAVE,              // back to the saved frame                 (saved frame, value -- value)
+    OP_CALL,               // n: call with n arguments                (function, args -- value)
+    OP_TAIL_CALL,          // n: call with n arguments in place of the current function
+    OP_RETURN,             //                                         (value -- )
+    OP_COUNT
+} opcode;
+
+// A compiled lambda body or top-level form. A Code is a GC_CODE object, and its
+// instructions and constants array are GC_RAW ones; all of them are allocated
+// in the old generation, so the VM can hold on to pointers into them while it
+// runs. The collector traces the constants. A top-level form's code is garbage
+// once it has run, and a lambda's once no closure of it is left.
+//
+// A global reference's cache operand is a constant that starts out NULL, and
+// holds the global's (symbol . value) cell once the reference has found it.
+// Cells never move and globals are never removed (see addBinding), so that is
+// safe too, and it turns every lookup after the first into a single load.
+typedef struct Code {
+    int *instructions;
+    SchemeItem **constants;
+    int constantCount;
+    int paramCount;
+    int frameSize;
+    bool rest;
+    int maxStack; // the most values the code ever has on the stack at once
+    SchemeItem *name; // for a lambda, the variable it was defined as, or NULL
+} Code;
+
+// Runs compiled top-level code (see compiler.h) and returns its value.
+SchemeItem *vmRun(Code *code);
+
+// Calls a procedure (a closure made by the VM, or a primitive) with a list of
+// arguments, for primitives that take a procedure.
+SchemeItem *vmApply(SchemeItem *function, SchemeItem *args);
+
+#endif